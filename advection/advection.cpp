@@ -6,282 +6,268 @@
 #endif
 
 // include project headers
-#include "mesh.h"   // Mesh
+#include "mesh.h"        // Mesh
+#include "fixed_mesh.h"  // NewMesh
+#include "field.h"       // Field
+#include "tracers.h"     // Tracers
+#include "strokes.h"     // Strokes
+#include "amr.h"         // Amr
+#include "diagnostics.h" // Diagnostics
+#include "app.h"         // App
+#include "canvas.h"      // Canvas
 
 // include standard C/C++ libraries
-#include<iostream>  // exit
-#include<cmath>     // abs
-#include<unistd.h>  // usleep
+#include<iostream>  // cout, cerr
+#include<cstring>   // memset, strcmp
+#include<vector>    // vector
 
 // include CImg for reading image files
 #include "CImg.h"
 using namespace cimg_library;
 
-// forward declarations
-void motion(int x, int y);
-
-class Pixel {
-private :
-  float coordinate[2];
-  float dimension[2];
-  float color[3];
-  
-public :
-
-  void setCoordinate(float x, float y) {
-    coordinate[0] = x;
-    coordinate[1] = y;
-  }
-   
-  void setDimension(float w, float h) {
-    dimension[0] = w;
-    dimension[1] = h;
-  }
-
-  void setColor(float r, float g, float b) {
-    color[0] = r;
-    color[1] = g;
-    color[2] = b;
-  }
-
-  float value(void) {
-    return color[0];
-  }
-
-  void addValue(float c) {
-    color[0] += c;
-    color[1] += c;
-    color[2] += c;
-  }
-
-  void render(void) {
-    // vertices are draw in normalized device coordinates (NDC)
-    glColor3f(color[0], color[1], color[2]); // color vertex 1
-    glVertex2f(coordinate[0]-0.5*dimension[0],coordinate[1]-0.5*dimension[1]);
-
-    glColor3f(color[0], color[1], color[2]); // color vertex 2
-    glVertex2f(coordinate[0]+0.5*dimension[0],coordinate[1]-0.5*dimension[1]);
-
-    glColor3f(color[0], color[1], color[2]); // color vertex 3
-    glVertex2f(coordinate[0]+0.5*dimension[0],coordinate[1]+0.5*dimension[1]);
-
-    glColor3f(color[0], color[1], color[2]); // color vertex 4
-    glVertex2f(coordinate[0]-0.5*dimension[0],coordinate[1]+0.5*dimension[1]);
-  }
-};
-
-class Grid {
+class Grid : public Simulation {
 private :
-  int Nx, Ny, Px, Py;
+  int Nx, Ny;
   Mesh* mesh;
-  Pixel* pixels;
+  Canvas canvas;
+  Tracers* tracers;
+  Amr* amr;
+  Diagnostics* diagnostics;
+  Strokes strokes;
+  std::vector<float> points;
+  std::vector<float> dye;
   float time;
+  long steps;
 
 public :
 
-  void initialize(CImg<float>& image) {
-    mesh = new Mesh(image);
+  void initialize(Mesh* m) {
+    mesh = m;
+    tracers = NULL;
+    amr = NULL;
+    diagnostics = NULL;
     time = 0.0;
-    std::cout << image.spectrum() << std::endl;
-    Nx = image.width();
-    Ny = image.height();
-    Px = 12*Nx;
-    Py = 12*Ny;
-    float w = 2.0 / Nx;
-    float h = 2.0 / Ny;
-    pixels = new Pixel[Nx*Ny];
+    steps = 0;
+    Nx = mesh->Ex;
+    Ny = mesh->Ey;
+    canvas.initialize(Nx, Ny);
+    refresh();
+  } // initialize
+
+  void setObstacles(CImg<float>& image) {
+    mesh->LoadSolids(image, 0);
+    refresh();
+  }
+
+  bool refresh(void) {
+    // update the displayed cells that changed visibly (solid elements in
+    // dark red), returning whether the display needs redrawing
+    bool changed = false;
+    if (amr != NULL) {
+      // the adaptive dye, sampled on its finest level
+      int s = amr->levels, nx = Nx << s, ny = Ny << s;
+      dye.resize(nx*ny);
+      amr->Rasterize(dye.data(), nx, ny);
+      for (int j = 0; j < ny; j++) {
+	for (int i = 0; i < nx; i++) {
+	  float c = dye[nx*j+i];
+	  if (mesh->Solid(i >> s, j >> s)) {
+	    changed |= canvas.refresh(i, j, 0.5, 0.0, 0.0);
+	  } else {
+	    changed |= canvas.refresh(i, j, c, c, c);
+	  }
+	}
+      }
+      return changed || (tracers != NULL);
+    }
     for (int j = 0; j < Ny; j++) {
-      float y = h * (j + 0.5) - 1.0;
       for (int i = 0; i < Nx; i++) {
 	float c = mesh->He[Nx*j+i];
-	float x = w * (i + 0.5) - 1.0;
-	pixels[i+Nx*j].setCoordinate(x, y);
-	pixels[i+Nx*j].setDimension(w, h);
-	pixels[i+Nx*j].setColor(c,c,c);
+	if (mesh->Solid(i,j)) {
+	  changed |= canvas.refresh(i, j, 0.5, 0.0, 0.0);
+	} else {
+	  changed |= canvas.refresh(i, j, c, c, c);
+	}
       }
     }
-  } // initialize
-
-  float getTime(void) {
-    return time;
+    return changed || (tracers != NULL);
   }
 
-  void setTime(float t) {
-    time = t;
-  }
-
-  void update(float dt) {
-    // update the solution
+  void step(float dt) {
+    // paint the queued brush strokes, update the tracers, the solution,
+    // and the adaptive dye
+    strokes.Apply(*mesh);
+    if (tracers != NULL) tracers->Update(dt);
     mesh->UpdateFields(dt);
+    if (amr != NULL) amr->Step(dt);
 
-    // update time
+    // update time, and record the diagnostics
     time += dt;
+    steps++;
+    if (diagnostics != NULL) diagnostics->Record(*mesh, steps, time);
   }
 
   int width(void) {
-    return Px;
+    return 12*Nx;
   }
 
   int height(void) {
-    return Py;
-  }
-
-  void setWidth(int p) {
-    Px = p;
-  }
-
-  void setHeight(int p) {
-    Py = p;
+    return 12*Ny;
   }
 
-  void keyboard(unsigned char c, int x, int y) {
-    if (c == 27) { // ASCII code for the escape key
-      exit(0);
-    }
-  }
-
-  void mouse(int button, int state, int x, int y) {
-    if ((button == GLUT_LEFT_BUTTON) && (state == GLUT_DOWN)) {
-      float w = 2.0 / Nx;
-      float h = 2.0 / Ny;
-      int i = std::min(std::max(int(floor(((2.0 / Px) * x) / w)),0),Nx-1);
-      int j = std::min(std::max(int(floor((2.0 - (2.0 / Py) * y) / h)),0),Ny-1);
-      mesh->He[Nx*j+i] = 1.0;
-      glutMotionFunc(motion);
-      glutPostRedisplay(); // refresh the display
+  void keyboard(unsigned char c) {
+    if (c == 'l') { // toggle the lumped-mass remap
+      mesh->lumped = !mesh->lumped;
+      std::cout << "lumped remap: " << mesh->lumped
+                << ", sweeps: " << mesh->sweeps << std::endl;
+    } else if ((c == '+') || (c == '=')) { // add a correction sweep
+      mesh->sweeps++;
+      std::cout << "lumped remap: " << mesh->lumped
+                << ", sweeps: " << mesh->sweeps << std::endl;
+    } else if ((c == '-') && (mesh->sweeps > 0)) { // remove a correction sweep
+      mesh->sweeps--;
+      std::cout << "lumped remap: " << mesh->lumped
+                << ", sweeps: " << mesh->sweeps << std::endl;
+    } else if (c == 'c') { // cycle the remap correction
+      const char* names[] = { "first order", "MacCormack", "BFECC" };
+      mesh->correction = (mesh->correction + 1) % 3;
+      std::cout << "remap correction: " << names[mesh->correction] << std::endl;
+    } else if (c == 'e') { // toggle the Galerkin remap / semi-Lagrangian backtrace
+      mesh->engine = (mesh->engine == Mesh::GALERKIN) ? Mesh::SEMI_LAGRANGIAN : Mesh::GALERKIN;
+      std::cout << "advection: " << ((mesh->engine == Mesh::GALERKIN) ? "remap" : "backtrace")
+                << " (gather: " << mesh->gather << ")" << std::endl;
+    } else if (c == 'p') { // toggle periodic boundaries / lid-driven walls
+      if (mesh->bc[Mesh::LEFT] == Mesh::PERIODIC) {
+	for (int s = Mesh::LEFT; s <= Mesh::TOP; s++) {
+	  mesh->SetBoundary(s, Mesh::NOSLIP, 5.0);
+	}
+      } else {
+	mesh->SetBoundary(Mesh::LEFT, Mesh::PERIODIC);
+	mesh->SetBoundary(Mesh::BOTTOM, Mesh::PERIODIC);
+      }
+      std::cout << "periodic: " << (mesh->bc[Mesh::LEFT] == Mesh::PERIODIC) << std::endl;
+    } else if (c == 's') { // toggle the exact (spectral) viscous step
+      mesh->EnableSpectralViscosity(mesh->spectral == NULL);
+      std::cout << "spectral viscosity (periodic): " << (mesh->spectral != NULL) << std::endl;
+    } else if (c == 't') { // toggle the tracers
+      if (tracers == NULL) {
+	tracers = new Tracers(mesh, 10000);
+      } else {
+	delete tracers;
+	tracers = NULL;
+	if (mesh->Fxn != NULL) {
+	  memset(mesh->Fxn, 0, (mesh->Nx*mesh->Ny)*sizeof(float));
+	  memset(mesh->Fyn, 0, (mesh->Nx*mesh->Ny)*sizeof(float));
+	}
+      }
+      std::cout << "tracers: " << (tracers != NULL) << std::endl;
+    } else if (c == 'a') { // toggle the adaptive dye (seeded from the mesh)
+      if (amr == NULL) {
+	amr = new Amr(mesh, 2);
+	canvas.initialize(Nx << amr->levels, Ny << amr->levels);
+      } else {
+	delete amr;
+	amr = NULL;
+	canvas.initialize(Nx, Ny);
+      }
+      std::cout << "adaptive dye: " << (amr != NULL);
+      if (amr != NULL) std::cout << " (" << amr->Leaves() << " blocks)";
+      std::cout << std::endl;
+    } else if (c == 'd') { // toggle the diagnostics (written to diagnostics.csv)
+      if (diagnostics == NULL) {
+	diagnostics = new Diagnostics("diagnostics.csv");
+      } else {
+	std::cout << "diagnostics: " << diagnostics->dropped << " samples dropped" << std::endl;
+	delete diagnostics;
+	diagnostics = NULL;
+      }
+      std::cout << "diagnostics: " << (diagnostics != NULL) << std::endl;
+    } else if ((c == 'f') && (tracers != NULL)) { // toggle two-way coupling
+      tracers->feedback = !tracers->feedback;
+      std::cout << "two-way coupling: " << tracers->feedback << std::endl;
+    } else if ((c == ']') || ((c == '[') && (strokes.radius > 0.5))) { // brush size
+      strokes.radius += (c == ']') ? 0.5 : -0.5;
+      std::cout << "brush radius: " << strokes.radius << std::endl;
     }
   }
 
-  void m_motion(int x, int y) {
-    float w = 2.0 / Nx;
-    float h = 2.0 / Ny;
-    int i = std::min(std::max(int(floor(((2.0 / Px) * x) / w)),0),Nx-1);
-    int j = std::min(std::max(int(floor((2.0 - (2.0 / Py) * y) / h)),0),Ny-1);
-    mesh->He[Nx*j+i] = 1.0;
-    glutPostRedisplay(); // refresh the display
+  void pointer(float x, float y, bool start) {
+    // start or extend a stroke (painted at the next step)
+    strokes.Push(0.5 * (x + 1.0) * Nx, 0.5 * (y + 1.0) * Ny, start);
   }
 
   void render(void) {
-    // clear the current bit buffers, restoring them to their preset values
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // update pixel colors, and draw quadrilaterals
-    glBegin(GL_QUADS);
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 0; i < Nx; i++) {
-	float c = mesh->He[Nx*j+i];
-	pixels[i+Nx*j].setColor(c,c,c);
-	pixels[i+Nx*j].render();
+    // upload the changed tiles, and draw the cells
+    canvas.upload();
+    glColor3f(1.0, 1.0, 1.0);
+    canvas.draw();
+
+    // draw the tracers as points, with a single call
+    if (tracers != NULL) {
+      Particles* balls = tracers->balls;
+      points.resize(2*balls->N);
+      for (int p = 0; p < balls->N; p++) {
+	points[2*p]   = balls->x[p];
+	points[2*p+1] = balls->y[p];
       }
+      glColor3f(1.0, 0.5, 0.0);
+      glPointSize(2.0);
+      glEnableClientState(GL_VERTEX_ARRAY);
+      glVertexPointer(2, GL_FLOAT, 0, points.data());
+      glDrawArrays(GL_POINTS, 0, balls->N);
+      glDisableClientState(GL_VERTEX_ARRAY);
     }
-    glEnd(); // GL_QUADS
-
-    // for double buffering: display buffer that was just rendered
-    glutSwapBuffers();
-
   } // render
-};
-
-// declare global grid instance
-Grid g;
-
-void keyboard(unsigned char c, int x, int y) {
-  g.keyboard(c, x, y);
-}
-
-void mouse(int button, int state, int x, int y) {
-  g.mouse(button, state, x, y);
-}
-
-void motion(int x, int y) {
-  g.m_motion(x, y);
-}
-
-void render(void) {
-  g.render();
-}
 
-void idle(void) {
-  float t = glutGet(GLUT_ELAPSED_TIME);
-  float dt = (t - g.getTime()) / 1000;
-  g.setTime(t);
-  g.update(dt);
-  glutMouseFunc(mouse);
-  glutPostRedisplay(); // refresh the display
-}
-
-void reshape(int w, int h) {
-  // Prevent a divide by zero, when window is too short
-  // (you cant make a window of zero width).
-  if (h == 0) {h = 1;}
-  float ratio = (1.0 * w) / h;
-
-  // change pixel dimension of the window
-  g.setWidth(glutGet(GLUT_WINDOW_WIDTH));
-  g.setHeight(glutGet(GLUT_WINDOW_HEIGHT));
-
-  // Use the Projection Matrix
-  glMatrixMode(GL_PROJECTION);
-
-  // Reset Matrix
-  glLoadIdentity();
-
-  // Set the viewport to be the entire window
-  // -1st & 2nd args: (x,y) coordinate of the bottom-left viewport corner
-  // -3rd & 4th args: (x,y) coordinate of the top-right viewport corner
-  glViewport(0, 0, w, h);
-
-  // Set the correct perspective.
-  // -1st arg: field of view angle in yz plane
-  // -2nd arg: (re-)define width-to-height ratio of the viewport
-  // -3rd arg: depth value of near clipping plane
-  // -4th arg: depth value of far clipping plane
-  gluPerspective(0,ratio,0,1000);
-
-  // Get Back to the Modelview
-  // -uses the scaling matrix in other glut functions, as needed
-  glMatrixMode(GL_MODELVIEW);
-}
+  bool rasterize(unsigned char* image, int w, int h) {
+    // the cells (without the tracers)
+    canvas.rasterize(image, w, h);
+    return true;
+  } // rasterize
+
+  bool hash(uint64_t* h) {
+    // the velocities and the pressure head
+    *h = mesh->Hash();
+    return true;
+  } // hash
+};
 
 int main(int argc, char** argv) {
-  CImg<float> image("initial_conditions.png");
-  g.initialize(image); // initialize the grid
-
-  // initialize glut
-  glutInit(&argc, argv);
-
-  // specify the initial position of the display window
-  //  -default value is (-1,-1), leading to automatic window placement
-  glutInitWindowPosition(100, 100);
-
-  // specify the initial size of the display window (in pixels)
-  glutInitWindowSize(g.width(), g.height());
-
-  // initialize the display modes:
-  // -define colors via RGBA values
-  // -use double buffering (for smoother animations)
-  // -use depth buffering (to correctly occlude objects with greater depth)
-  glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
-
-  // create the display window with the specified name
-  glutCreateWindow("Grid");
+  Grid g;
+
+  // load the initial conditions: use the (memory-mapped) NPY or raw file
+  // given on the command line, or the cached copy of the PNG image (made
+  // from the image when the cache is missing)
+  //  usage: ./advection [file.npy | file.f32 width height [channels]
+  //                               | file.u16 width height [channels]]
+  const char* cache = "initial_conditions.npy";
+  const char* filename = (argc > 1) ? argv[1] : cache;
+  if (argc > 3) {
+    std::string name(filename);
+    Field::Type type = (name.size() > 4) && (name.substr(name.size()-4) == ".u16")
+                     ? Field::UINT16 : Field::FLOAT32;
+    int channels = (argc > 4) ? atoi(argv[4]) : 1;
+    Field* field = new Field(filename, atoi(argv[2]), atoi(argv[3]), channels, type);
+    g.initialize(NewMesh(*field)); // initialize the grid
+  } else if (Field::Exists(filename)) {
+    Field* field = new Field(filename);
+    g.initialize(NewMesh(*field)); // initialize the grid
+  } else if (strcmp(filename, cache) != 0) {
+    std::cerr << "advection: cannot open " << filename << std::endl;
+    return 1;
+  } else {
+    CImg<float> image("initial_conditions.png");
+    Mesh* mesh = NewMesh(image);
+    Field::SaveNpy(cache, mesh->He, mesh->Ex, mesh->Ey);
+    g.initialize(mesh); // initialize the grid
+  }
 
-  // define call-back functions:
-  // -main display function to run if there is a state change
-  glutDisplayFunc(render);
-  // -function to run in response to window resizing
-  glutReshapeFunc(reshape);
-  // -function to run in response to keyboard input
-  glutKeyboardFunc(keyboard);
-  // -function to run in response to mouse input
-  glutMouseFunc(mouse);
-  // -function to run if no active input is provided
-  glutIdleFunc(idle);
-  
-  // enter main display loop
-  glutMainLoop();
+  // load the obstacles (channel 0 of the image marks solid elements)
+  if (Field::Exists("obstacles.png")) {
+    CImg<float> obstacles("obstacles.png");
+    g.setObstacles(obstacles);
+  }
 
-  // the program should never reach this point; return 1 if it does
-  return 1;
+  App app(&g, "Advection", "advection", g.width(), g.height());
+  return app.run(argc, argv);
 }
-
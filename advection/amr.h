@@ -0,0 +1,491 @@
+#ifndef AMR_H
+#define AMR_H
+
+// include standard C/C++ libraries
+#include <cmath>     // abs
+#include <vector>    // vector
+#include <algorithm> // min, max, swap
+#include <cstring>   // memcpy
+
+// include project headers
+#include "mesh.h"    // Mesh
+
+// A dye (passive scalar) field on a block-structured quadtree, carried by
+// the velocity of a (uniform) mesh.
+//
+// The domain is tiled by root blocks of B x B elements of the mesh; every
+// block either is a leaf, which holds B x B cells of the dye, or is split
+// into four children of B x B cells of half the size, down to a finest
+// level. Leaves are refined where the dye varies sharply (undivided
+// differences between adjacent cells) or the flow rotates fast (the
+// vorticity of the mesh), and sibling leaves are merged back where neither
+// does, so that the number of cells follows the complexity of the dye
+// rather than the area of the domain. The flags are spread to the
+// neighboring leaves, so that the refined regions keep a buffer of one
+// block around the features.
+//
+// Every leaf is advanced with the remap of a patch mesh of (B+2G)^2
+// elements of its level (one patch mesh per level, reused by every leaf,
+// with the compile-time kernels of its size): the nodal velocities are
+// interpolated (bilinearly, with weights per row and per column) from the
+// mesh, the ghost ring of G elements is filled from the neighboring leaves
+// (found once per regrid: their averages over finer cells, or the
+// enclosing coarser cells), and the dye is integrated and remapped with the
+// bilinear Integrate/Remap/Interpolate operators of the patch. The
+// transfers between levels are conservative: a merged cell takes the
+// average of its four children, and a split cell passes its value to its
+// four children.
+//
+// Notes: all levels take the same time step, which must keep the
+// displacement within the ghost ring at the finest level; obstacles are
+// ignored; the dye is not refluxed at coarse/fine interfaces.
+class Amr {
+public:
+
+  enum { B = 16 }; // Block size (in cells)
+  enum { G = 2 };  // Ghost ring width (in cells)
+  enum { N = B + 2*G }; // Patch size (in cells)
+
+  struct Block {
+    int level;                // Level (0 for root blocks), -1 if unused
+    int i, j;                 // Position (in blocks of its level)
+    int child;                // First of four children, or -1 for a leaf
+    std::vector<float> He;    // Dye (leaves only) [B*B]
+    int around[9];            // Blocks holding the ghost cells, per region
+                              // of the patch (leaves only) [3*3]
+  };
+
+  // Parameters
+  Mesh* mesh;      // Mesh carrying the dye
+  int levels;      // Finest level
+  float gradient;  // Refinement threshold on the undivided dye differences
+  float vorticity; // Refinement threshold on the vorticity (1/s)
+  int interval;    // Steps between regrids
+
+  // Quadtree
+  int Rx, Ry;                // Number of root blocks
+  std::vector<Block> blocks; // Root blocks first [Rx*Ry + ...]
+
+  Amr(Mesh* m, int l = 2) {
+    mesh = m;
+    levels = l;
+    gradient = 0.05;
+    vorticity = 1.0;
+    interval = 4;
+    steps = 0;
+    Rx = (mesh->Ex + B-1) / B;
+    Ry = (mesh->Ey + B-1) / B;
+    blocks.resize(Rx*Ry);
+    for (int bj = 0; bj < Ry; bj++) {
+      for (int bi = 0; bi < Rx; bi++) {
+	Block& b = blocks[Rx*bj+bi];
+	b.level = 0;
+	b.i = bi;
+	b.j = bj;
+	b.child = -1;
+	b.He.resize(B*B);
+	for (int cj = 0; cj < B; cj++) {
+	  for (int ci = 0; ci < B; ci++) {
+	    int x = std::min(B*bi+ci, mesh->Ex-1);
+	    int y = std::min(B*bj+cj, mesh->Ey-1);
+	    b.He[B*cj+ci] = mesh->He[mesh->Ex*y+x];
+	  }
+	}
+      }
+    }
+    rowx.resize(2*(N+1)*(N+2));
+    for (int k = 0; k <= levels; k++) {
+      patch.push_back(new Mesh(N, N, mesh->dx / (1 << k)));
+    }
+    for (int k = 0; k < levels; k++) {
+      Regrid();
+    }
+    Connect();
+  } // Amr
+
+  ~Amr() {
+    for (size_t k = 0; k < patch.size(); k++) {
+      delete patch[k];
+    }
+  } // ~Amr
+
+  // The patch meshes are owned: no copies
+  Amr(const Amr&) = delete;
+  Amr& operator=(const Amr&) = delete;
+
+  void Step(float dt) {
+    // Advance the dye of every leaf over dt, with the current velocities
+    // of the mesh, then regrid (every few steps)
+    next.resize(blocks.size());
+    for (size_t b = 0; b < blocks.size(); b++) {
+      if ((blocks[b].level < 0) || (blocks[b].child >= 0)) continue;
+      next[b].resize(B*B);
+      Advance(b, dt);
+    }
+    for (size_t b = 0; b < blocks.size(); b++) {
+      if ((blocks[b].level < 0) || (blocks[b].child >= 0)) continue;
+      blocks[b].He.swap(next[b]);
+    }
+    if (++steps % interval == 0) Regrid();
+  } // Step
+
+  void Regrid(void) {
+    // Merge the groups of four sibling leaves where nothing is flagged,
+    // then refine the flagged leaves (above the finest level); the leaves
+    // made by either pass are marked, and left to the next regrid, so that
+    // a level is coarsened or refined at most once per regrid
+    Vorticity();
+    size_t n = blocks.size();
+    flag.assign(n, 0.0);
+    for (size_t b = 0; b < n; b++) {
+      if ((blocks[b].level < 0) || (blocks[b].child >= 0)) continue;
+      flag[b] = Indicator(b);
+    }
+    buffer.assign(n, 0.0);
+    for (size_t b = 0; b < n; b++) {
+      if ((blocks[b].level < 0) || (blocks[b].child >= 0)) continue;
+      buffer[b] = Buffer(b);
+    }
+    made.assign(n, 0);
+    for (size_t b = 0; b < n; b++) {
+      if ((blocks[b].level < 0) || (blocks[b].child < 0)) continue;
+      int c = blocks[b].child;
+      bool merge = true;
+      for (int q = 0; q < 4; q++) {
+	merge = merge && (blocks[c+q].child < 0) && !made[c+q] && (buffer[c+q] < 0.5);
+      }
+      if (merge) {
+	Merge(b);
+	made[b] = 1;
+      }
+    }
+    for (size_t b = 0; b < n; b++) {
+      if ((blocks[b].level < 0) || (blocks[b].child >= 0) || made[b]) continue;
+      if ((blocks[b].level < levels) && (buffer[b] > 1.0)) {
+	Split(b);
+	for (int q = 0; q < 4; q++) { // children in reused blocks
+	  size_t c = blocks[b].child + q;
+	  if (c < n) made[c] = 1;
+	}
+      }
+    }
+    Connect();
+  } // Regrid
+
+  float Value(int level, int gi, int gj, int from = -1) {
+    // Dye of cell (gi,gj) of a level (in cells of that level, from the
+    // origin of the mesh): the value of the enclosing cell of a coarser
+    // leaf, or the average of the covering cells of finer leaves; cells
+    // outside the root blocks take the value of the nearest cell inside.
+    // The search starts from a block known to enclose the cell, if any
+    gi = std::min(std::max(gi, 0), (B*Rx << level) - 1);
+    gj = std::min(std::max(gj, 0), (B*Ry << level) - 1);
+    int b = Find(level, gi, gj, from);
+    const Block& k = blocks[b];
+    if (k.child < 0) {
+      int s = level - k.level;
+      return k.He[B*((gj >> s) - B*k.j) + (gi >> s) - B*k.i];
+    }
+    return 0.25*(Value(level+1, 2*gi, 2*gj, b)   + Value(level+1, 2*gi+1, 2*gj, b)
+                +Value(level+1, 2*gi, 2*gj+1, b) + Value(level+1, 2*gi+1, 2*gj+1, b));
+  } // Value
+
+  void Rasterize(float* out, int nx, int ny) {
+    // Sample the dye on the finest level, into nx x ny cells
+    for (size_t b = 0; b < blocks.size(); b++) {
+      const Block& k = blocks[b];
+      if ((k.level < 0) || (k.child >= 0)) continue;
+      int s = levels - k.level;
+      for (int cj = 0; cj < (B << s); cj++) {
+	int y = ((B*k.j) << s) + cj;
+	if (y >= ny) break;
+	for (int ci = 0; ci < (B << s); ci++) {
+	  int x = ((B*k.i) << s) + ci;
+	  if (x >= nx) break;
+	  out[nx*y+x] = k.He[B*(cj >> s) + (ci >> s)];
+	}
+      }
+    }
+  } // Rasterize
+
+  int Leaves(void) {
+    int count = 0;
+    for (size_t b = 0; b < blocks.size(); b++) {
+      if ((blocks[b].level >= 0) && (blocks[b].child < 0)) count++;
+    }
+    return count;
+  } // Leaves
+
+  double Mass(void) {
+    // Total dye (times the element area of the mesh)
+    double mass = 0.0;
+    for (size_t b = 0; b < blocks.size(); b++) {
+      const Block& k = blocks[b];
+      if ((k.level < 0) || (k.child >= 0)) continue;
+      double sum = 0.0;
+      for (int c = 0; c < B*B; c++) {
+	sum += k.He[c];
+      }
+      mass += sum / (1 << (2*k.level));
+    }
+    return mass;
+  } // Mass
+
+private:
+
+  std::vector<Mesh*> patch;             // Patch mesh per level
+  std::vector<float> rowx;              // Velocities at the patch columns, on
+                                        // the rows of mesh nodes [2*(N+1)*(N+2)]
+  std::vector<std::vector<float> > next; // Advanced dye, per block
+  std::vector<float> omega;             // Element vorticity of the mesh [Ex*Ey]
+  std::vector<float> flag;              // Indicator per leaf [blocks]
+  std::vector<float> buffer;            // Indicator over the neighbors [blocks]
+  std::vector<char> made;               // Leaves made by the current regrid [blocks]
+  std::vector<int> unused;              // Unused groups of four blocks
+  long steps;                           // Steps taken
+
+  int Find(int level, int gi, int gj, int from = -1) {
+    // Deepest block, down to the level, enclosing cell (gi,gj) of the level
+    // (searched from its root block, or from an enclosing block)
+    int b = (from >= 0) ? from : Rx*((gj >> level) / B) + (gi >> level) / B;
+    while ((blocks[b].child >= 0) && (blocks[b].level < level)) {
+      int s = level - blocks[b].level - 1;
+      int qi = ((gi >> s) / B) & 1;
+      int qj = ((gj >> s) / B) & 1;
+      b = blocks[b].child + 2*qj + qi;
+    }
+    return b;
+  } // Find
+
+  void Connect(void) {
+    // Find the blocks around every leaf (after the leaves change), so that
+    // the ghost rings are filled without searching the quadtree at every
+    // step: the ghost cells of each of the 8 regions of the patch around
+    // the leaf (G wide) lie in one block of the level (once moved inside
+    // the root blocks), held by a leaf or refined
+    for (size_t b = 0; b < blocks.size(); b++) {
+      Block& k = blocks[b];
+      if ((k.level < 0) || (k.child >= 0)) continue;
+      for (int a = 0; a < 9; a++) {
+	int gi = std::min(std::max(B*k.i + B*(a%3 - 1), 0), (B*Rx << k.level) - 1);
+	int gj = std::min(std::max(B*k.j + B*(a/3 - 1), 0), (B*Ry << k.level) - 1);
+	k.around[a] = Find(k.level, gi, gj);
+      }
+    }
+  } // Connect
+
+  void Advance(int b, float dt) {
+    // Remap the dye of leaf b on the patch mesh of its level
+    const Block& k = blocks[b];
+    Mesh& p = *patch[k.level];
+    const int gi0 = B*k.i - G;    // first patch element (cells of the level)
+    const int gj0 = B*k.j - G;
+    const float h = 1.0 / (1 << k.level); // cell size (elements of the mesh)
+
+    // velocities at the patch nodes, interpolated from the mesh nodes (and
+    // zero outside the mesh): the samples and weights of the columns and of
+    // the rows, then along x on the rows of mesh nodes under the patch, and
+    // along y on the rows of the patch
+    const int Nx = mesh->Nx;
+    int mi[N+1], mj[N+1];
+    float fx[N+1], fy[N+1], ox[N+1], oy[N+1];
+    for (int r = 0; r <= N; r++) {
+      float x = (gi0 + r) * h;
+      mi[r] = std::min(std::max(int(x), 0), mesh->Ex-1);
+      fx[r] = x - mi[r];
+      ox[r] = ((x >= 0.0) && (x <= mesh->Ex)) ? 1.0 : 0.0;
+      float y = (gj0 + r) * h;
+      mj[r] = std::min(std::max(int(y), 0), mesh->Ey-1);
+      fy[r] = y - mj[r];
+      oy[r] = ((y >= 0.0) && (y <= mesh->Ey)) ? 1.0 : 0.0;
+    }
+    const int j0 = mj[0], rows = mj[N] - j0 + 2;
+    float* ux = &rowx[0];
+    float* vx = &rowx[(N+1)*rows];
+    for (int j = 0; j < rows; j++) {
+      const float* u = mesh->Vxn + Nx*(j0 + j);
+      const float* v = mesh->Vyn + Nx*(j0 + j);
+      for (int r = 0; r <= N; r++) {
+	int m = mi[r];
+	ux[(N+1)*j+r] = ox[r] * ((1-fx[r])*u[m] + fx[r]*u[m+1]);
+	vx[(N+1)*j+r] = ox[r] * ((1-fx[r])*v[m] + fx[r]*v[m+1]);
+      }
+    }
+    for (int q = 0; q <= N; q++) {
+      const float* u0 = ux + (N+1)*(mj[q] - j0);
+      const float* v0 = vx + (N+1)*(mj[q] - j0);
+      const float a = oy[q] * (1-fy[q]), c = oy[q] * fy[q];
+      float* u = p.Vxn + (N+1)*q;
+      float* v = p.Vyn + (N+1)*q;
+      for (int r = 0; r <= N; r++) {
+	u[r] = a*u0[r] + c*u0[r+N+1];
+	v[r] = a*v0[r] + c*v0[r+N+1];
+      }
+    }
+
+    // dye of the leaf, and of its ghost ring: read from the leaf around
+    // each region (or averaged from the finer leaves of a refined block)
+    for (int q = 0; q < B; q++) {
+      memcpy(p.He + N*(q+G) + G, &k.He[B*q], B*sizeof(float));
+    }
+    int ci[N], cj[N]; // ghost cells moved inside the root blocks
+    for (int r = 0; r < N; r++) {
+      ci[r] = std::min(std::max(gi0 + r, 0), (B*Rx << k.level) - 1);
+      cj[r] = std::min(std::max(gj0 + r, 0), (B*Ry << k.level) - 1);
+    }
+    const int first[3] = { 0, G, B+G }, width[3] = { G, B, G }; // per region
+    for (int a = 0; a < 9; a++) {
+      if (a == 4) continue;
+      const int r0 = first[a%3], r1 = r0 + width[a%3];
+      const int q0 = first[a/3], q1 = q0 + width[a/3];
+      const Block& n = blocks[k.around[a]];
+      if (n.child >= 0) {
+	for (int q = q0; q < q1; q++) {
+	  for (int r = r0; r < r1; r++) {
+	    p.He[N*q+r] = Value(k.level, ci[r], cj[q], k.around[a]);
+	  }
+	}
+	continue;
+      }
+      const int s = k.level - n.level;
+      for (int q = q0; q < q1; q++) {
+	const float* row = &n.He[0] + B*((cj[q] >> s) - B*n.j);
+	for (int r = r0; r < r1; r++) {
+	  p.He[N*q+r] = row[(ci[r] >> s) - B*n.i];
+	}
+      }
+    }
+
+    // remap (with the kernels of the patch size), and keep the leaf cells
+    p.dt = dt;
+    p.lumped = mesh->lumped;
+    p.sweeps = mesh->sweeps;
+    p.UpdateIntegralOperator<N,N>();
+    p.UpdateElementField<N,N>(p.He);
+    for (int q = 0; q < B; q++) {
+      memcpy(&next[b][B*q], p.He + N*(q+G) + G, B*sizeof(float));
+    }
+  } // Advance
+
+  void Vorticity(void) {
+    // Vorticity of the mesh velocity, per element
+    const int Ex = mesh->Ex, Ey = mesh->Ey, Nx = mesh->Nx;
+    const float* u = mesh->Vxn;
+    const float* v = mesh->Vyn;
+    omega.resize(Ex*Ey);
+    for (int j = 0; j < Ey; j++) {
+      for (int i = 0; i < Ex; i++) {
+	int m = Nx*j+i;
+	float dvdx = 0.5*(v[m+1] - v[m] + v[m+Nx+1] - v[m+Nx]) / mesh->dx;
+	float dudy = 0.5*(u[m+Nx] - u[m] + u[m+Nx+1] - u[m+1]) / mesh->dx;
+	omega[Ex*j+i] = dvdx - dudy;
+      }
+    }
+  } // Vorticity
+
+  float Indicator(int b) {
+    // Refinement indicator of a leaf, relative to the thresholds (above 1:
+    // refine, below 1/2: may merge)
+    const Block& k = blocks[b];
+    float d = 0.0;
+    for (int cj = 0; cj < B; cj++) {
+      for (int ci = 0; ci < B; ci++) {
+	float c = k.He[B*cj+ci];
+	if (ci+1 < B) d = std::max(d, std::abs(k.He[B*cj+ci+1] - c));
+	if (cj+1 < B) d = std::max(d, std::abs(k.He[B*(cj+1)+ci] - c));
+      }
+    }
+    // vorticity over the elements of the mesh covered by the leaf
+    float w = 0.0;
+    int s = B >> std::min(k.level, 4); // covered elements per side
+    s = std::max(s, 1);
+    int i0 = (B*k.i >> k.level), j0 = (B*k.j >> k.level);
+    for (int j = j0; j < std::min(j0 + s, mesh->Ey); j++) {
+      for (int i = i0; i < std::min(i0 + s, mesh->Ex); i++) {
+	w = std::max(w, std::abs(omega[mesh->Ex*j+i]));
+      }
+    }
+    return std::max(d / gradient, w / vorticity);
+  } // Indicator
+
+  float Subtree(int b) {
+    // Largest indicator of the leaves under block b
+    if (blocks[b].child < 0) return flag[b];
+    float f = 0.0;
+    for (int q = 0; q < 4; q++) {
+      f = std::max(f, Subtree(blocks[b].child + q));
+    }
+    return f;
+  } // Subtree
+
+  float Buffer(int b) {
+    // Largest indicator of leaf b and of the leaves around it: a leaf next
+    // to a flagged one is refined as well, so that coarse/fine interfaces
+    // stay a block away from the sharp features of the dye (where the
+    // unrefluxed interfaces would otherwise lose or gain dye)
+    const Block& k = blocks[b];
+    float f = flag[b];
+    for (int dj = -1; dj <= 1; dj++) {
+      for (int di = -1; di <= 1; di++) {
+	int gi = B*(k.i + di), gj = B*(k.j + dj);
+	if ((gi < 0) || (gj < 0) || (gi >= (B*Rx << k.level)) || (gj >= (B*Ry << k.level))) continue;
+	f = std::max(f, Subtree(Find(k.level, gi, gj)));
+      }
+    }
+    return f;
+  } // Buffer
+
+  void Split(int b) {
+    // Make four child leaves, each cell passing its value to the four
+    // cells it covers
+    int c;
+    if (!unused.empty()) {
+      c = unused.back();
+      unused.pop_back();
+    } else {
+      c = blocks.size();
+      blocks.resize(c + 4);
+    }
+    for (int q = 0; q < 4; q++) {
+      Block& k = blocks[c+q];
+      k.level = blocks[b].level + 1;
+      k.i = 2*blocks[b].i + (q & 1);
+      k.j = 2*blocks[b].j + (q >> 1);
+      k.child = -1;
+      k.He.resize(B*B);
+      for (int cj = 0; cj < B; cj++) {
+	for (int ci = 0; ci < B; ci++) {
+	  int pi = ((q & 1)*B + ci) / 2;
+	  int pj = ((q >> 1)*B + cj) / 2;
+	  k.He[B*cj+ci] = blocks[b].He[B*pj+pi];
+	}
+      }
+    }
+    blocks[b].child = c;
+    std::vector<float>().swap(blocks[b].He);
+  } // Split
+
+  void Merge(int b) {
+    // Replace four child leaves by their averages
+    int c = blocks[b].child;
+    Block& k = blocks[b];
+    k.He.resize(B*B);
+    for (int cj = 0; cj < B; cj++) {
+      for (int ci = 0; ci < B; ci++) {
+	const Block& h = blocks[c + 2*(2*cj/B) + (2*ci/B)];
+	int hi = (2*ci) % B, hj = (2*cj) % B;
+	k.He[B*cj+ci] = 0.25*(h.He[B*hj+hi]     + h.He[B*hj+hi+1]
+	                     +h.He[B*(hj+1)+hi] + h.He[B*(hj+1)+hi+1]);
+      }
+    }
+    for (int q = 0; q < 4; q++) {
+      blocks[c+q].level = -1;
+      std::vector<float>().swap(blocks[c+q].He);
+    }
+    k.child = -1;
+    unused.push_back(c);
+  } // Merge
+
+};
+
+#endif // AMR_H
@@ -0,0 +1,80 @@
+// Compare the cost of carrying thin dye filaments on the quadtree (a
+// 256x256 mesh, refined twice) and on a uniform mesh of the finest
+// resolution (1024x1024), in a solid-body rotation, for 1 to 8 filaments:
+// the work on the quadtree follows the number of filaments, the work on
+// the uniform mesh only depends on its area.
+//
+// usage: ./amr_benchmark [steps]
+
+// include project headers
+#include "mesh.h"       // Mesh
+#include "fixed_mesh.h" // NewMesh
+#include "amr.h"        // Amr
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi
+#include<chrono>    // steady_clock
+
+// rotate the mesh about its center (with a period of T seconds), and paint
+// n vertical filaments, 1 element wide, in its left half
+void initialize(Mesh* mesh, int n, float T, float scale) {
+  const int Ex = mesh->Ex, Ey = mesh->Ey, Nx = mesh->Nx;
+  const float w = 2.0 * 3.14159265 / T;
+  for (int j = 0; j <= Ey; j++) {
+    for (int i = 0; i <= Ex; i++) {
+      mesh->Vxn[Nx*j+i] = -w * (j - 0.5*Ey) * mesh->dx;
+      mesh->Vyn[Nx*j+i] = +w * (i - 0.5*Ex) * mesh->dx;
+    }
+  }
+  for (int j = 0; j < Ey; j++) {
+    for (int i = 0; i < Ex; i++) {
+      bool filament = false;
+      for (int f = 0; f < n; f++) {
+	int x = int(scale * (16 + 12*f));
+	filament |= (i >= x) && (i < x + scale) && (j >= Ey/4) && (j < 3*Ey/4);
+      }
+      mesh->He[Ex*j+i] = filament ? 1.0 : 0.0;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  int steps = (argc > 1) ? std::atoi(argv[1]) : 20;
+  const float T = 200.0, dt = 0.05; // under one finest cell per step
+
+  // uniform mesh of the finest resolution (velocities held fixed)
+  Mesh* fine = NewMesh(1024, 1024, 0.25);
+  fine->lumped = true;
+  initialize(fine, 1, T, 4.0);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int s = 0; s < steps; s++) {
+    fine->UpdateIntegralOperator();
+    fine->UpdateElementField(fine->He);
+  }
+  std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+  double t0 = std::chrono::duration<double,std::milli>(stop - start).count() / steps;
+  std::cout << "# uniform 1024x1024: " << t0 << " ms/step" << std::endl;
+  delete fine;
+
+  std::cout << "# filaments   leaves   cells     (of uniform)   AMR (ms/step)   mass drift" << std::endl;
+  for (int n = 1; n <= 8; n *= 2) {
+    Mesh* mesh = NewMesh(256, 256, 1.0);
+    mesh->lumped = true;
+    initialize(mesh, n, T, 1.0);
+    Amr amr(mesh, 2);
+    double m0 = amr.Mass();
+    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+      amr.Step(dt);
+    }
+    stop = std::chrono::steady_clock::now();
+    double t1 = std::chrono::duration<double,std::milli>(stop - start).count() / steps;
+    long cells = (long)amr.Leaves() * Amr::B * Amr::B;
+    std::cout << n << "             " << amr.Leaves() << "      " << cells
+              << "     " << 100.0 * cells / (1024.0*1024.0) << "%          " << t1
+              << "        " << (amr.Mass() - m0) / m0 << std::endl;
+    delete mesh;
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+// Check that the fields are reproducible bit for bit, by their hashes after
+// every step of a lid-driven cavity (with a block of pressure head), for
+// the lumped and consistent remaps: a rerun of a mesh must match it, and a
+// mesh with compile-time dimensions must match the same kernels built with
+// run-time dimensions. Both builds run the same (optimized) kernels, so this
+// checks the specialization, not the kernels against an independent
+// reference. The semi-Lagrangian backtrace sampled with AVX2 gathers is
+// checked against its plain scalar loop (when the CPU has gathers). The
+// first step whose hashes differ is reported (or none).
+//
+// The costs of hashing the fields, and of the fixed-order sum of squares of
+// Norm against a running sum, are reported per step.
+//
+// usage: ./determinism_benchmark [steps]
+
+// include project headers
+#include "mesh.h"       // Mesh
+#include "fixed_mesh.h" // FixedMesh
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdio>    // printf
+#include<cstdlib>   // atoi
+#include<vector>    // vector
+#include<chrono>    // steady_clock
+
+// the hashes of the fields after every step
+std::vector<uint64_t> run(Mesh* mesh, bool lumped, int steps,
+                          int engine = Mesh::GALERKIN, bool gather = false) {
+  const int n = mesh->Ex;
+  mesh->lumped = lumped;
+  mesh->engine = engine;
+  mesh->gather = mesh->gather && gather;
+  for (int j = 0; j < n/2; j++) {
+    for (int i = 0; i < n/2; i++) {
+      mesh->He[n*j+i] = 1.0;
+    }
+  }
+  std::vector<uint64_t> hashes;
+  for (int s = 0; s < steps; s++) {
+    mesh->UpdateFields(1.0/60.0);
+    hashes.push_back(mesh->Hash());
+  }
+  delete mesh;
+  return hashes;
+}
+
+// the first step whose hashes differ, or 0
+int firstDifference(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+  for (size_t s = 0; s < a.size(); s++) {
+    if (a[s] != b[s]) return s + 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  int steps = (argc > 1) ? std::atoi(argv[1]) : 100;
+
+  std::cout << "# remap        fixed vs run-time   rerun (fixed)   rerun (run-time)   final hash"
+            << std::endl;
+  for (int lumped = 1; lumped >= 0; lumped--) {
+    std::vector<uint64_t> fixed  = run(new FixedMesh<256,256>(1.0), lumped, steps);
+    std::vector<uint64_t> fixed2 = run(new FixedMesh<256,256>(1.0), lumped, steps);
+    std::vector<uint64_t> loose  = run(new Mesh(256, 256, 1.0), lumped, steps);
+    std::vector<uint64_t> loose2 = run(new Mesh(256, 256, 1.0), lumped, steps);
+    printf("%s   %d                   %d               %d                  %016llx\n",
+           lumped ? "lumped    " : "consistent", firstDifference(fixed, loose),
+           firstDifference(fixed, fixed2), firstDifference(loose, loose2),
+           (unsigned long long)fixed.back());
+  }
+  std::cout << "# (0: identical at every step)" << std::endl;
+
+  Mesh probe(8, 8, 1.0);
+  std::vector<uint64_t> gathered = run(new FixedMesh<256,256>(1.0), true, steps,
+                                       Mesh::SEMI_LAGRANGIAN, true);
+  std::vector<uint64_t> scalar   = run(new FixedMesh<256,256>(1.0), true, steps,
+                                       Mesh::SEMI_LAGRANGIAN, false);
+  printf("# semi-Lagrangian, gather vs scalar sampling: %d%s\n",
+         firstDifference(gathered, scalar), probe.gather ? "" : " (no gathers on this CPU)");
+
+  // costs, per step of a 1024x1024 mesh
+  Mesh* mesh = new FixedMesh<1024,1024>(1.0);
+  mesh->lumped = true;
+  const int N = mesh->Nx * mesh->Ny;
+  const int repeats = 20;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; r++) {
+    mesh->UpdateFields(1.0/60.0);
+  }
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  uint64_t h = 0;
+  for (int r = 0; r < repeats; r++) {
+    mesh->He[0] = r; // a changed field, hashed again
+    h ^= mesh->Hash();
+  }
+  std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+  // a residual with an exact sum of squares of 32/N per node (in the
+  // mean), in float
+  for (int i = 0; i < N; i++) {
+    mesh->Fn[i] = 1.0e-3 * (i % 97);
+  }
+  double exact = 0.0;
+  for (int i = 0; i < N; i++) {
+    exact += double(mesh->Fn[i]) * mesh->Fn[i];
+  }
+  float pairwise = 0.0;
+  for (int r = 0; r < repeats; r++) {
+    pairwise = Mesh::SumSquares(mesh->Fn, N);
+  }
+  std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+  float running = 0.0;
+  for (int r = 0; r < repeats; r++) {
+    running = 0.0;
+    for (int i = 0; i < N; i++) {
+      running += mesh->Fn[i] * mesh->Fn[i];
+    }
+  }
+  std::chrono::steady_clock::time_point t4 = std::chrono::steady_clock::now();
+  double step = std::chrono::duration<double,std::milli>(t1 - t0).count() / repeats;
+  double hash = std::chrono::duration<double,std::milli>(t2 - t1).count() / repeats;
+  double bytes = 4.0 * (2*N + mesh->Ex*mesh->Ey);
+  std::cout << "# 1024x1024 (lumped): step " << step << " ms, hash " << hash << " ms ("
+            << 1.0e-6 * bytes / hash << " GB/s), sum of squares: fixed order "
+            << std::chrono::duration<double,std::milli>(t3 - t2).count() / repeats
+            << " ms (relative error " << (pairwise - exact) / exact << "), running sum "
+            << std::chrono::duration<double,std::milli>(t4 - t3).count() / repeats
+            << " ms (relative error " << (running - exact) / exact << ")" << std::endl;
+  printf("# (hashes %016llx)\n", (unsigned long long)h);
+  delete mesh;
+  return 0;
+}
@@ -0,0 +1,233 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+// include standard C/C++ libraries
+#include <cstdio>    // FILE, fopen, fprintf, fwrite
+#include <cstring>   // strrchr, strcmp, memcpy
+#include <cstdint>   // int32_t
+#include <cmath>     // sqrt
+#include <algorithm> // max, max_element
+#include <atomic>    // atomic
+#include <thread>    // thread, sleep_for
+#include <chrono>    // milliseconds
+
+// include project headers
+#include "mesh.h"      // Mesh
+#include "denormals.h" // FlushDenormals
+
+// Statistics of the fields of a mesh, taken after every step: the mass of
+// the pressure head, the kinetic energy and maximum speed (on the nodes, with
+// the lumped mass), and the L2 norms of the divergence and of the vorticity
+// (enstrophy, 1/2 |w|^2), at the element centers.
+//
+// All statistics are measured in one sweep over the rows of nodes: a row of
+// elements is taken right after the second row of its nodes, while both are
+// in cache, and the row sums are accumulated in 8 independent lanes, so that
+// the compiler vectorizes them (a single running sum is a serial chain).
+// Denormals are read as zeros: the velocities of the quiet corners of a
+// cavity decay into them, and would make the sweep several times slower.
+//
+// Samples are queued in a lock-free single-producer/single-consumer ring
+// buffer, drained by a background thread to a CSV file, or to a binary file
+// of raw Sample records when the file name ends with ".bin": the solver
+// never waits on the file, and drops the samples of a full buffer instead.
+class Diagnostics {
+public:
+
+  enum { CAPACITY = 4096 }; // Ring buffer capacity (a power of 2)
+
+  struct Sample {
+    long step;         // Step number
+    double time;       // Simulation time
+    double mass;       // Integral of the pressure head
+    double energy;     // Kinetic energy (per unit density)
+    double speed;      // Maximum nodal speed
+    double divergence; // L2 norm of the divergence
+    double enstrophy;  // Integral of 1/2 |w|^2
+  };
+
+  long dropped; // Samples dropped (buffer full)
+
+  Diagnostics(const char* filename) {
+    const char* ext = strrchr(filename, '.');
+    binary = (ext != NULL) && (strcmp(ext, ".bin") == 0);
+    file = fopen(filename, binary ? "wb" : "w");
+    if ((file != NULL) && !binary) {
+      fprintf(file, "step,time,mass,kinetic_energy,max_speed,divergence,enstrophy\n");
+    }
+    dropped = 0;
+    head = 0;
+    tail = 0;
+    stop = false;
+    writer = std::thread([this] { Write(); });
+  } // Diagnostics
+
+  ~Diagnostics() {
+    // Drain the buffer, and close the file
+    stop.store(true, std::memory_order_release);
+    writer.join();
+    if (file != NULL) fclose(file);
+  } // ~Diagnostics
+
+  bool Good(void) {
+    return (file != NULL);
+  } // Good
+
+  bool Record(const Mesh& mesh, long step, double time) {
+    // Measure the fields, and queue the sample (producer side), returning
+    // false if it was dropped
+    unsigned h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == CAPACITY) {
+      dropped++;
+      return false;
+    }
+    Sample& s = samples[h % CAPACITY];
+    s = Measure(mesh);
+    s.step = step;
+    s.time = time;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  } // Record
+
+  static Sample Measure(const Mesh& mesh) {
+    // Take the statistics of the fields, in one sweep. The last column
+    // (row) of nodes of a periodic mesh repeats the first, with the full
+    // lumped mass of the node: it is left out of the nodal statistics
+    const int Nx = mesh.Nx, Ny = mesh.Ny, Ex = mesh.Ex, Ey = mesh.Ey;
+    const int nx = (mesh.bc[Mesh::LEFT]   == Mesh::PERIODIC) ? Ex : Nx; // distinct nodes per row,
+    const int ny = (mesh.bc[Mesh::BOTTOM] == Mesh::PERIODIC) ? Ey : Ny; // and rows of nodes
+    const float* Vxn = mesh.Vxn;
+    const float* Vyn = mesh.Vyn;
+    const float* He  = mesh.He;
+    const float* Wn  = mesh.Wn;
+    double mass = 0.0, energy = 0.0, div2 = 0.0, vort2 = 0.0;
+    float speed2 = 0.0;
+    FlushDenormals flush;
+    for (int j = 0; j < ny; j++) {
+      // nodes of row j: kinetic energy and speed
+      const float* vx = Vxn + Nx*j;
+      const float* vy = Vyn + Nx*j;
+      const float* w  = Wn + Nx*j;
+      float e[8] = {0};
+      int32_t m[8] = {0};
+      int i = 0;
+      for (; i + 8 <= nx; i += 8) {
+	for (int l = 0; l < 8; l++) {
+	  float v2 = vx[i+l]*vx[i+l] + vy[i+l]*vy[i+l];
+	  e[l] += v2 / w[i+l];
+	  m[l] = std::max(m[l], Bits(v2));
+	}
+      }
+      for (; i < nx; i++) {
+	float v2 = vx[i]*vx[i] + vy[i]*vy[i];
+	e[0] += v2 / w[i];
+	m[0] = std::max(m[0], Bits(v2));
+      }
+      if (j == Ey) {
+	energy += Reduce(e);
+	speed2 = std::max(speed2, Maximum(m));
+	break;
+      }
+
+      // elements of row j (between node rows j and j+1): mass, and the
+      // divergence and vorticity at the centers (in units of 1/(2 dx))
+      const float* h = He + Ex*j;
+      float a[8] = {0}, d[8] = {0}, c[8] = {0};
+      i = 0;
+      for (; i + 8 <= Ex; i += 8) {
+	for (int l = 0; l < 8; l++) {
+	  float dxx = vx[i+l+1] - vx[i+l] + vx[Nx+i+l+1] - vx[Nx+i+l];
+	  float dyx = vx[Nx+i+l] - vx[i+l] + vx[Nx+i+l+1] - vx[i+l+1];
+	  float dxy = vy[i+l+1] - vy[i+l] + vy[Nx+i+l+1] - vy[Nx+i+l];
+	  float dyy = vy[Nx+i+l] - vy[i+l] + vy[Nx+i+l+1] - vy[i+l+1];
+	  a[l] += h[i+l];
+	  d[l] += (dxx + dyy) * (dxx + dyy);
+	  c[l] += (dxy - dyx) * (dxy - dyx);
+	}
+      }
+      for (; i < Ex; i++) {
+	float dxx = vx[i+1] - vx[i] + vx[Nx+i+1] - vx[Nx+i];
+	float dyx = vx[Nx+i] - vx[i] + vx[Nx+i+1] - vx[i+1];
+	float dxy = vy[i+1] - vy[i] + vy[Nx+i+1] - vy[Nx+i];
+	float dyy = vy[Nx+i] - vy[i] + vy[Nx+i+1] - vy[i+1];
+	a[0] += h[i];
+	d[0] += (dxx + dyy) * (dxx + dyy);
+	c[0] += (dxy - dyx) * (dxy - dyx);
+      }
+      energy += Reduce(e);
+      speed2 = std::max(speed2, Maximum(m));
+      mass += Reduce(a);
+      div2 += Reduce(d);
+      vort2 += Reduce(c);
+    }
+
+    // scale the sums (the squared element derivatives carry a factor
+    // 4 dx^2, which cancels the area of the elements)
+    const double area = double(mesh.dx) * mesh.dx;
+    Sample s;
+    s.step = 0;
+    s.time = 0.0;
+    s.mass = mass * area;
+    s.energy = 0.5 * energy;
+    s.speed = std::sqrt(speed2);
+    s.divergence = std::sqrt(0.25 * div2);
+    s.enstrophy = 0.125 * vort2;
+    return s;
+  } // Measure
+
+private:
+
+  Sample samples[CAPACITY];
+  std::atomic<unsigned> head; // Next sample to write
+  std::atomic<unsigned> tail; // Next sample to read
+  std::atomic<bool> stop;     // The writer drains the buffer and returns
+  std::thread writer;
+  FILE* file;
+  bool binary;
+
+  static double Reduce(const float* x) {
+    return (double(x[0]) + x[1] + x[2] + x[3]) + (double(x[4]) + x[5] + x[6] + x[7]);
+  } // Reduce
+
+  static int32_t Bits(float x) {
+    // The bits of a float, which order non-negative floats as integers (a
+    // float max is only vectorized under -ffinite-math-only)
+    int32_t b;
+    memcpy(&b, &x, sizeof(b));
+    return b;
+  } // Bits
+
+  static float Maximum(const int32_t* b) {
+    int32_t m = *std::max_element(b, b + 8);
+    float x;
+    memcpy(&x, &m, sizeof(x));
+    return x;
+  } // Maximum
+
+  void Write(void) {
+    // Drain the buffer to the file (consumer side), until stopped
+    while (true) {
+      bool stopping = stop.load(std::memory_order_acquire);
+      unsigned t = tail.load(std::memory_order_relaxed);
+      unsigned h = head.load(std::memory_order_acquire);
+      for (unsigned k = t; k != h; k++) {
+	const Sample& s = samples[k % CAPACITY];
+	if (file == NULL) {
+	  continue;
+	} else if (binary) {
+	  fwrite(&s, sizeof(Sample), 1, file);
+	} else {
+	  fprintf(file, "%ld,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", s.step, s.time, s.mass,
+	          s.energy, s.speed, s.divergence, s.enstrophy);
+	}
+      }
+      tail.store(h, std::memory_order_release);
+      if (stopping) break;
+      if (h == t) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    if (file != NULL) fflush(file);
+  } // Write
+
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,123 @@
+// Measure the cost of the in-situ diagnostics against the cost of a step,
+// and against reading the fields back in one pass per statistic (in double
+// precision, as a check of the fused sweep), for a lid-driven cavity with a
+// block of pressure head; a run of every size records a sample per step to
+// diagnostics_<size>.csv, and the time of a step with and without the
+// diagnostics is reported.
+//
+// usage: ./diagnostics_benchmark [max_size] [steps]
+
+// include project headers
+#include "mesh.h"        // Mesh
+#include "fixed_mesh.h"  // NewMesh
+#include "diagnostics.h" // Diagnostics
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdio>    // snprintf
+#include<cstdlib>   // atoi
+#include<cmath>     // sqrt, abs
+#include<algorithm> // max
+#include<chrono>    // steady_clock
+
+// the statistics of Diagnostics::Measure, one pass per statistic
+Diagnostics::Sample readBack(const Mesh& mesh) {
+  const int Nx = mesh.Nx, Ny = mesh.Ny, Ex = mesh.Ex, Ey = mesh.Ey;
+  const float* vx = mesh.Vxn;
+  const float* vy = mesh.Vyn;
+  Diagnostics::Sample s = {0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  for (int e = 0; e < Ex*Ey; e++) {
+    s.mass += mesh.He[e] * double(mesh.dx) * mesh.dx;
+  }
+  for (int n = 0; n < Nx*Ny; n++) {
+    s.energy += 0.5 * (double(vx[n])*vx[n] + double(vy[n])*vy[n]) / mesh.Wn[n];
+  }
+  for (int n = 0; n < Nx*Ny; n++) {
+    s.speed = std::max(s.speed, std::sqrt(double(vx[n])*vx[n] + double(vy[n])*vy[n]));
+  }
+  for (int j = 0; j < Ey; j++) {
+    for (int i = 0; i < Ex; i++) {
+      int n = Nx*j+i;
+      double d = (double(vx[n+1]) - vx[n] + vx[n+Nx+1] - vx[n+Nx]
+                 + double(vy[n+Nx]) - vy[n] + vy[n+Nx+1] - vy[n+1]) / (2.0*mesh.dx);
+      s.divergence += d * d * mesh.dx * mesh.dx;
+    }
+  }
+  s.divergence = std::sqrt(s.divergence);
+  for (int j = 0; j < Ey; j++) {
+    for (int i = 0; i < Ex; i++) {
+      int n = Nx*j+i;
+      double w = (double(vy[n+1]) - vy[n] + vy[n+Nx+1] - vy[n+Nx]
+                 - double(vx[n+Nx]) + vx[n] - vx[n+Nx+1] + vx[n+1]) / (2.0*mesh.dx);
+      s.enstrophy += 0.5 * w * w * mesh.dx * mesh.dx;
+    }
+  }
+  return s;
+}
+
+double relative(double a, double b) {
+  return std::abs(a - b) / std::max(std::abs(b), 1.0e-30);
+}
+
+int main(int argc, char** argv) {
+  int max_size = (argc > 1) ? std::atoi(argv[1]) : 1024;
+  int steps    = (argc > 2) ? std::atoi(argv[2]) : 50;
+  std::cout << "# size   step (ms)   in-situ (ms)   read-back (ms)   step+diagnostics (ms)"
+            << "   dropped   max relative difference" << std::endl;
+  for (int n = 256; n <= max_size; n *= 2) {
+    Mesh* mesh = NewMesh(n, n, 1.0);
+    mesh->lumped = true;
+    for (int j = 0; j < n/2; j++) {
+      for (int i = 0; i < n/2; i++) {
+	mesh->He[n*j+i] = 1.0;
+      }
+    }
+    for (int s = 0; s < 10; s++) {
+      mesh->UpdateFields(1.0/60.0); // set the cavity in motion
+    }
+
+    // a step, the fused sweep, and the read-back passes, alone
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+      mesh->UpdateFields(1.0/60.0);
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    Diagnostics::Sample a;
+    for (int s = 0; s < steps; s++) {
+      a = Diagnostics::Measure(*mesh);
+    }
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    Diagnostics::Sample b;
+    for (int s = 0; s < steps; s++) {
+      b = readBack(*mesh);
+    }
+    std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+    double difference = std::max(std::max(relative(a.mass, b.mass), relative(a.energy, b.energy)),
+                                 std::max(std::max(relative(a.speed, b.speed),
+                                                   relative(a.divergence, b.divergence)),
+                                          relative(a.enstrophy, b.enstrophy)));
+
+    // steps recording a sample each
+    char filename[64];
+    snprintf(filename, sizeof(filename), "diagnostics_%d.csv", n);
+    long dropped;
+    std::chrono::steady_clock::time_point t4 = std::chrono::steady_clock::now();
+    {
+      Diagnostics diagnostics(filename);
+      for (int s = 0; s < steps; s++) {
+	mesh->UpdateFields(1.0/60.0);
+	diagnostics.Record(*mesh, s, s / 60.0);
+      }
+      dropped = diagnostics.dropped;
+    }
+    std::chrono::steady_clock::time_point t5 = std::chrono::steady_clock::now();
+
+    std::cout << n << "      " << std::chrono::duration<double,std::milli>(t1 - t0).count() / steps
+              << "     " << std::chrono::duration<double,std::milli>(t2 - t1).count() / steps
+              << "        " << std::chrono::duration<double,std::milli>(t3 - t2).count() / steps
+              << "          " << std::chrono::duration<double,std::milli>(t5 - t4).count() / steps
+              << "                " << dropped << "         " << difference << std::endl;
+    delete mesh;
+  }
+  return 0;
+}
@@ -0,0 +1,231 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+// include standard C/C++ libraries
+#include <cstdio>    // snprintf
+#include <cstring>   // memcpy
+#include <vector>    // vector
+#include <deque>     // deque
+#include <thread>    // thread, hardware_concurrency, yield
+#include <mutex>     // mutex, lock_guard
+#include <atomic>    // atomic
+#include <chrono>    // steady_clock
+#include <fstream>   // ofstream
+#include <algorithm> // min, max
+
+// include project headers
+#include "mesh.h"        // Mesh
+#include "fixed_mesh.h"  // NewMesh
+#include "diagnostics.h" // Diagnostics
+
+// A batch of independent meshes (the members of a parameter sweep), all of
+// the same size and started from the same pressure head, advanced together
+// without a display.
+//
+// The initial pressure head is shared (read-only) by the members, which
+// copy it when they are added. Members are advanced in tasks of a few
+// steps, on a pool of workers with one task queue each: a worker takes its
+// own tasks last-in first-out (so that a member stays in its cache), and
+// when its queue runs dry, steals the oldest task of another worker; a
+// member that is not done is queued again by the worker that advanced it.
+// Each member writes its own diagnostics (one CSV line of the statistics of
+// Diagnostics every few steps).
+class Ensemble {
+public:
+
+  struct Member {
+    float viscosity; // Kinematic viscosity
+    float lid;       // Wall speed (of the four walls of the cavity)
+    Mesh* mesh;      // Fields
+    std::ofstream out; // Diagnostics, when opened
+    long steps;      // Steps taken
+    long target;     // Steps to take by the end of the run
+    double seconds;  // Time spent in steps
+  };
+
+  // Discretization parameters (shared by the members)
+  int Ex, Ey; // Number of elements in the x- and y-directions
+  float dx;   // Grid spacing
+  float dt;   // Time step
+  bool lumped; // Remap with the lumped (row-summed) mass matrix
+
+  // Scheduling parameters
+  int threads; // Number of workers
+  int chunk;   // Steps per task
+  int every;   // Steps between two lines of diagnostics (0 for none)
+
+  const float* initial; // Shared initial pressure head [Ex*Ey]
+  std::vector<Member*> members;
+
+  // Statistics of the runs
+  double seconds; // Wall time
+  long steals;    // Tasks taken from another worker
+
+  Ensemble(int ex, int ey, float width, const float* He0) {
+    Ex = ex;
+    Ey = ey;
+    dx = width;
+    dt = 1.0/60.0; // default initialization: a frame of the app
+    lumped = false; // default initialization
+    threads = std::max(1u, std::thread::hardware_concurrency());
+    chunk = 4;     // default initialization
+    every = 0;     // default initialization: no diagnostics
+    initial = He0;
+    seconds = 0.0;
+    steals = 0;
+  } // Ensemble
+
+  ~Ensemble() {
+    for (size_t m = 0; m < members.size(); m++) {
+      delete members[m]->mesh;
+      delete members[m];
+    }
+  } // ~Ensemble
+
+  int Add(float viscosity, float lid, const char* prefix = NULL) {
+    // Add a member, writing its diagnostics to <prefix><index>.csv when a
+    // prefix is given, and return its index
+    Member* member = new Member;
+    member->viscosity = viscosity;
+    member->lid = lid;
+    member->mesh = NewMesh(Ex, Ey, dx);
+    member->mesh->lumped = lumped;
+    member->mesh->viscosity = viscosity;
+    for (int s = Mesh::LEFT; s <= Mesh::TOP; s++) {
+      member->mesh->SetBoundary(s, Mesh::NOSLIP, lid);
+    }
+    memcpy(member->mesh->He, initial, Ex*Ey*sizeof(float));
+    member->steps = 0;
+    member->target = 0;
+    member->seconds = 0.0;
+    if (prefix != NULL) {
+      char filename[256];
+      snprintf(filename, sizeof(filename), "%s%03d.csv", prefix, int(members.size()));
+      member->out.open(filename);
+      member->out << "# viscosity " << viscosity << ", lid " << lid << std::endl;
+      member->out << "step,time,mass,kinetic_energy,max_speed,divergence,enstrophy" << std::endl;
+    }
+    members.push_back(member);
+    return members.size() - 1;
+  } // Add
+
+  void Run(int steps) {
+    // Advance every member by a number of steps
+    const int K = members.size();
+    const int T = std::max(1, std::min(threads, K));
+    for (int m = 0; m < K; m++) {
+      members[m]->target = members[m]->steps + steps;
+    }
+
+    // deal the members to the workers, round-robin
+    std::vector<Queue> queues(T);
+    for (int m = 0; m < K; m++) {
+      queues[m % T].tasks.push_back(m);
+    }
+
+    std::atomic<int> remaining(K);
+    std::atomic<long> stolen(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 1; t < T; t++) {
+      pool.push_back(std::thread([&, t] { Work(t, queues, remaining, stolen); }));
+    }
+    Work(0, queues, remaining, stolen);
+    for (size_t t = 0; t < pool.size(); t++) {
+      pool[t].join();
+    }
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    seconds += std::chrono::duration<double>(stop - start).count();
+    steals += stolen;
+  } // Run
+
+  double Throughput(void) {
+    // Aggregate element-steps per second (over the wall time)
+    long steps = 0;
+    for (size_t m = 0; m < members.size(); m++) {
+      steps += members[m]->steps;
+    }
+    return (seconds > 0.0) ? double(Ex) * Ey * steps / seconds : 0.0;
+  } // Throughput
+
+  double Utilization(void) {
+    // Fraction of the wall time of the workers spent in steps
+    double busy = 0.0;
+    for (size_t m = 0; m < members.size(); m++) {
+      busy += members[m]->seconds;
+    }
+    int T = std::max(1, std::min(threads, int(members.size())));
+    return (seconds > 0.0) ? busy / (seconds * T) : 0.0;
+  } // Utilization
+
+private:
+
+  struct Queue {
+    std::mutex lock;
+    std::deque<int> tasks; // Indices of the members
+  };
+
+  void Work(int t, std::vector<Queue>& queues, std::atomic<int>& remaining,
+            std::atomic<long>& stolen) {
+    // Run tasks (from the back of the own queue, or else from the front of
+    // another queue) until every member is done
+    const int T = queues.size();
+    while (remaining.load(std::memory_order_acquire) > 0) {
+      int m = -1;
+      {
+	std::lock_guard<std::mutex> guard(queues[t].lock);
+	if (!queues[t].tasks.empty()) {
+	  m = queues[t].tasks.back();
+	  queues[t].tasks.pop_back();
+	}
+      }
+      for (int v = 1; (m < 0) && (v < T); v++) {
+	Queue& victim = queues[(t+v) % T];
+	std::lock_guard<std::mutex> guard(victim.lock);
+	if (!victim.tasks.empty()) {
+	  m = victim.tasks.front();
+	  victim.tasks.pop_front();
+	  stolen++;
+	}
+      }
+      if (m < 0) { // every member is in flight
+	std::this_thread::yield();
+	continue;
+      }
+
+      Advance(*members[m]);
+      if (members[m]->steps < members[m]->target) {
+	std::lock_guard<std::mutex> guard(queues[t].lock);
+	queues[t].tasks.push_back(m);
+      } else {
+	remaining.fetch_sub(1, std::memory_order_release);
+      }
+    }
+  } // Work
+
+  void Advance(Member& member) {
+    // Take the steps of a task, writing the diagnostics when they are due
+    int n = std::min<long>(chunk, member.target - member.steps);
+    for (int s = 0; s < n; s++) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      member.mesh->UpdateFields(dt);
+      std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+      member.seconds += std::chrono::duration<double>(stop - start).count();
+      member.steps++;
+      if ((every > 0) && member.out.is_open() && (member.steps % every == 0)) {
+	Diagnose(member);
+      }
+    }
+  } // Advance
+
+  void Diagnose(Member& member) {
+    // Write the statistics of the fields
+    Diagnostics::Sample s = Diagnostics::Measure(*member.mesh);
+    member.out << member.steps << "," << member.steps * dt << "," << s.mass << ","
+               << s.energy << "," << s.speed << "," << s.divergence << ","
+               << s.enstrophy << "\n";
+  } // Diagnose
+
+};
+
+#endif // ENSEMBLE_H
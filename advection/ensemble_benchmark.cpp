@@ -0,0 +1,52 @@
+// Measure the aggregate throughput of a parameter sweep (viscosity x lid
+// speed) of lid-driven cavities, started from the same block of pressure
+// head, for 1 to all cores; the members of the run on all cores write their
+// diagnostics to ensemble_<member>.csv.
+//
+// usage: ./ensemble_benchmark [members] [size] [steps] [lumped]
+
+// include project headers
+#include "ensemble.h" // Ensemble
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi
+#include<vector>    // vector
+#include<thread>    // hardware_concurrency
+
+int main(int argc, char** argv) {
+  int K     = (argc > 1) ? std::atoi(argv[1]) : 16;
+  int n     = (argc > 2) ? std::atoi(argv[2]) : 128;
+  int steps = (argc > 3) ? std::atoi(argv[3]) : 100;
+  bool lumped = (argc > 4) ? std::atoi(argv[4]) : 1;
+  int cores = std::max(1u, std::thread::hardware_concurrency());
+
+  // shared initial condition: a block of head in the lower left quarter
+  std::vector<float> He0(n*n, 0.0);
+  for (int j = 0; j < n/2; j++) {
+    for (int i = 0; i < n/2; i++) {
+      He0[n*j+i] = 1.0;
+    }
+  }
+
+  std::cout << "# " << K << " members, " << n << "x" << n << ", " << steps << " steps, "
+            << (lumped ? "lumped" : "consistent") << " remap" << std::endl;
+  std::cout << "# threads   wall (s)   Melement-steps/s   utilization   steals" << std::endl;
+  for (int threads = 1; threads <= cores; threads *= 2) {
+    Ensemble ensemble(n, n, 1.0, He0.data());
+    ensemble.threads = threads;
+    ensemble.lumped = lumped;
+    bool last = (2*threads > cores);
+    if (last) ensemble.every = 10;
+    for (int k = 0; k < K; k++) {
+      float viscosity = 0.005 * (1 << (k % 4));  // 0.005 to 0.04
+      float lid = 1.25 * (1 + (k / 4) % 4);      // 1.25 to 5.0
+      ensemble.Add(viscosity, lid, last ? "ensemble_" : NULL);
+    }
+    ensemble.Run(steps);
+    std::cout << threads << "           " << ensemble.seconds << "      "
+              << 1.0e-6 * ensemble.Throughput() << "          " << ensemble.Utilization()
+              << "      " << ensemble.steals << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,76 @@
+#ifndef FIXED_MESH_H
+#define FIXED_MESH_H
+
+// include project headers
+#include "mesh.h"   // Mesh
+#include "field.h"  // Field
+
+// A Mesh whose dimensions (and row strides) are compile-time constants, so
+// that the kernels may be fully unrolled and vectorized by the compiler
+template<int EX, int EY>
+class FixedMesh : public Mesh {
+public:
+
+  FixedMesh(float width) : Mesh(EX, EY, width) { } // FixedMesh
+
+  FixedMesh(CImg<float>& image) : Mesh(image) {
+    Check();
+  } // FixedMesh
+
+  FixedMesh(Field& field) : Mesh(field) {
+    Check();
+  } // FixedMesh
+
+  void UpdateFields(float new_dt) {
+    // Advance the fields, with compile-time dimensions
+    Update<EX,EY>(new_dt);
+  } // UpdateFields
+
+private:
+
+  void Check(void) {
+    if ((Ex != EX) || (Ey != EY)) {
+      std::cerr << "FixedMesh: " << Ex << "x" << Ey << " source does not match "
+                << EX << "x" << EY << " mesh" << std::endl;
+      exit(1);
+    }
+  } // Check
+
+};
+
+// Create a fixed-size mesh for the standard production grid sizes, or fall
+// back to a mesh with run-time dimensions otherwise
+template<class Source>
+Mesh* NewMesh(int ex, int ey, Source& source) {
+  if ((ex == 256) && (ey == 256)) {
+    return new FixedMesh<256,256>(source);
+  } else if ((ex == 512) && (ey == 512)) {
+    return new FixedMesh<512,512>(source);
+  } else if ((ex == 1024) && (ey == 1024)) {
+    return new FixedMesh<1024,1024>(source);
+  } else {
+    return new Mesh(source);
+  }
+} // NewMesh
+
+inline Mesh* NewMesh(CImg<float>& image) {
+  return NewMesh(image.width(), image.height(), image);
+} // NewMesh
+
+inline Mesh* NewMesh(Field& field) {
+  return NewMesh(field.width, field.height, field);
+} // NewMesh
+
+inline Mesh* NewMesh(int ex, int ey, float width) {
+  if ((ex == 256) && (ey == 256)) {
+    return new FixedMesh<256,256>(width);
+  } else if ((ex == 512) && (ey == 512)) {
+    return new FixedMesh<512,512>(width);
+  } else if ((ex == 1024) && (ey == 1024)) {
+    return new FixedMesh<1024,1024>(width);
+  } else {
+    return new Mesh(ex, ey, width);
+  }
+} // NewMesh
+
+#endif // FIXED_MESH_H
@@ -2,407 +2,1297 @@
 #define MESH_H
 
 // include standard C/C++ libraries
-#include <iostream> // exit
+#include <iostream> // cerr, exit
 #include <cmath>    // sqrt
-#include <cstring>  // memset
+#include <cstring>  // memset, memcpy
+#include <stdint.h> // uint32_t
+#include <algorithm> // min, max, swap
+
+// include the AVX2 intrinsics (compiled per function, and selected at run
+// time) on x86 targets
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h> // _mm256_i32gather_ps
+#define MESH_GATHER
+#endif
 
 // include CImg for reading image files
 #include "CImg.h"
 using namespace cimg_library;
 
+// include project headers
+#include "field.h"     // Field
+#include "spectral.h"  // SpectralDiffusion
+#include "hash.h"      // Hash64
+#include "denormals.h" // FlushDenormals
+
 class Mesh {
 public:
 
+  // Boundary sides, and boundary condition types
+  enum Side { LEFT, RIGHT, BOTTOM, TOP };
+  enum Boundary { NOSLIP, FREESLIP, INFLOW, OUTFLOW, PERIODIC };
+
+  // Remap corrections: none (first order), MacCormack (a forward and a
+  // backward remap), or BFECC (a forward, a backward, and a corrected
+  // forward remap)
+  enum Correction { FIRST_ORDER, MACCORMACK, BFECC };
+
+  // Advection engines: the Galerkin (ALE) remap, or the semi-Lagrangian
+  // backtrace of the nodes and element centers
+  enum Engine { GALERKIN, SEMI_LAGRANGIAN };
+
   // Discretization parameters
   int Nx, Ny; // Number of nodes in the x- and y-directions
   int Ex, Ey; // Number of elements in the x- and y-directions
   float dx;   // Grid spacing
   float dt;   // Time step
 
+  // Physical parameters
+  float viscosity; // Kinematic viscosity
+
+  // Remap parameters
+  bool lumped; // Remap with the lumped (row-summed) mass matrix
+  int sweeps;  // Number of defect-correction sweeps for the lumped remap
+  int correction; // Error correction of the remap (FIRST_ORDER, MACCORMACK, BFECC)
+  int engine;  // Advection engine (GALERKIN, SEMI_LAGRANGIAN)
+  bool gather; // Sample with AVX2 gathers (when the CPU supports them)
+
+  // Boundary conditions, per side (LEFT, RIGHT, BOTTOM, TOP)
+  int bc[4];   // Boundary condition type
+  float bv[4]; // Wall speed (NOSLIP, counter-clockwise) or inflow speed (INFLOW)
+
   // Field variables
   float* Vxn; // Nodal x-velocity      [Nx*Ny]
   float* Vyn; // Nodal y-velocity      [Nx*Ny]
   float* He;  // Element pressure head [Ex*Ey]
+  bool aliased; // He aliases a mapped file (and is not owned)
+
+  // Body forces
+  float* Fxn; // Nodal x-acceleration, or NULL [Nx*Ny]
+  float* Fyn; // Nodal y-acceleration, or NULL [Nx*Ny]
+
+  // Exact (spectral) viscous diffusion, for doubly-periodic meshes
+  SpectralDiffusion* spectral; // Plans, or NULL for the stencil
+
+  // Obstacles
+  int Bx;       // Number of 32-element tiles in the x-direction
+  uint32_t* Se; // Solid element mask, one bit per element [Bx*Ey]
+  int Bn;       // Number of 32-node tiles in the x-direction
+  uint32_t* Sn; // Solid node mask (no fluid element around), one bit per node [Bn*Ny]
+  uint32_t* Cn; // Cut node mask (fluid and solid elements around) [Bn*Ny]
+  int solidNodes; // Number of solid nodes
 
   // Transfer operators
   float* Re;  // Remap integral operator [4*Ex*Ey]
+  float* Rb;  // Backward (-dt) remap integral operator, or NULL [4*Ex*Ey]
+
+  // Semi-Lagrangian departure points, of the nodes (in Xn) then of the
+  // element centers (in Ge): first sample of the bilinear stencil, and the
+  // weights of the next samples in x (all points), then in y (all points)
+  int* Dk;    // Departure samples, or NULL [Nx*Ny+Ex*Ey]
+  float* Dw;  // Departure weights, or NULL [2*(Nx*Ny+Ex*Ey)]
+  int* Bk;    // Backward (-dt) departure samples, or NULL [Nx*Ny+Ex*Ey]
+  float* Bw;  // Backward (-dt) departure weights, or NULL [2*(Nx*Ny+Ex*Ey)]
+  float* Wn;  // Inverse lumped mass     [Nx*Ny]
 
   // Workspace arrays
   float* Un;  // Nodal field     [Nx*Ny]
   float* Ue;  // Element field   [Ex*Ey]
   float* Fn;  // Nodal residual  [Nx*Ny]
-  float* dUn; // Nodal increment [Nx*Ny]
+  float* dUn; // Nodal increment, with ghost layer [(Nx+2)*(Ny+2)]
+  float* Gn;  // Nodal field with ghost layer   [(Nx+2)*(Ny+2)]
+  float* Ge;  // Element field with ghost layer [(Ex+2)*(Ey+2)]
+  float* Xp;  // Field before the corrected remap, or NULL [Nx*Ny]
+  float* Xb;  // Field remapped forward and backward, or NULL [Nx*Ny]
 
   Mesh(int ex, int ey, float width) {
+    Initialize(ex, ey, width);
+    He  = new float[Ex*Ey](); // zero initialization
+    aliased = false;
+  } // Mesh
+
+  Mesh(CImg<float>& image) {
+    Initialize(image.width(), image.height(), 1.0);
+    He  = new float[Ex*Ey];
+    for (int j = 0; j < Ey; j++) {
+      for (int i = 0; i < Ex; i++) {
+	He[Ex*j+i] = image(i,j,0)/256.0; // grid height initialization
+      }
+    }
+    aliased = false;
+  } // Mesh
+
+  Mesh(Field& field) {
+    // Note: when channel 0 of the field is stored as contiguous float32
+    // samples, He aliases the (privately) mapped file, so the field must
+    // outlive the mesh
+    Initialize(field.width, field.height, 1.0);
+    He  = field.Channel(0);   // zero-copy initialization
+    aliased = (He != NULL);
+    if (!aliased) {
+      He = new float[Ex*Ey];
+      for (int j = 0; j < Ey; j++) {
+	for (int i = 0; i < Ex; i++) {
+	  He[Ex*j+i] = field(i,j,0); // grid height initialization
+	}
+      }
+    }
+    if (field.channels > 2) {
+      ElementToNode(field, 1, Vxn); // x-velocity initialization
+      ElementToNode(field, 2, Vyn); // y-velocity initialization
+    }
+    if (field.channels > 3) {
+      LoadSolids(field, 3); // obstacle initialization
+    }
+  } // Mesh
+
+  void Initialize(int ex, int ey, float width) {
+    // Set the dimensions and default parameters, and allocate all nodal
+    // fields and workspace arrays (the pressure head is left to the caller)
     Ex = ex;
     Ey = ey;
     Nx = Ex + 1;
     Ny = Ey + 1;
     dx = width;
     dt = 1.0; // default initialization
+    lumped = false; // default initialization
+    sweeps = 0;     // default initialization
+    correction = FIRST_ORDER; // default initialization
+    engine = GALERKIN;        // default initialization
+#ifdef MESH_GATHER
+    gather = __builtin_cpu_supports("avx2");
+#else
+    gather = false;
+#endif
     Vxn = new float[Nx*Ny](); // zero initialization
     Vyn = new float[Nx*Ny](); // zero initialization
-    He  = new float[Ex*Ey](); // zero initialization
     Re  = new float[4*Ex*Ey];
-    Un  = new float[Nx*Ny];
+    Wn  = new float[Nx*Ny];
+    Un  = new float[Nx*Ny](); // zero initialization: first guess of the element remap
     Ue  = new float[Ex*Ey];
     Fn  = new float[Nx*Ny];
-    dUn = new float[Nx*Ny];
-  } // Mesh
+    dUn = new float[(Nx+2)*(Ny+2)](); // zero initialization
+    Gn  = new float[(Nx+2)*(Ny+2)](); // zero initialization
+    Ge  = new float[(Ex+2)*(Ey+2)](); // zero initialization
+    Rb  = NULL; // allocated with the first corrected remap
+    Xp  = NULL;
+    Xb  = NULL;
+    Dk  = NULL; // allocated with the first semi-Lagrangian step
+    Dw  = NULL;
+    Bk  = NULL;
+    Bw  = NULL;
+    Fxn = NULL; // default initialization: no body forces
+    Fyn = NULL;
+    spectral = NULL; // default initialization: viscous stencil
+    viscosity = 0.01; // default initialization
+    Bx  = (Ex+31)/32;
+    Se  = new uint32_t[Bx*Ey](); // zero initialization: no solids
+    Bn  = (Nx+31)/32;
+    Sn  = new uint32_t[Bn*Ny];
+    Cn  = new uint32_t[Bn*Ny];
+    for (int s = LEFT; s <= TOP; s++) {
+      bc[s] = NOSLIP; // default initialization: lid-driven cavity
+      bv[s] = 5.0;
+    }
+    UpdateLumpedMass();
+  } // Initialize
 
-  Mesh(CImg<float>& image) {
-    Ex = image.width();
-    Ey = image.height();
-    Nx = Ex + 1;
-    Ny = Ey + 1;
-    dx = 1.0; // default initialization
-    dt = 1.0; // default initialization
-    Vxn = new float[Nx*Ny](); // zero initialization
-    Vyn = new float[Nx*Ny](); // zero initialization
-    He  = new float[Ex*Ey];
+  void ElementToNode(Field& field, int c, float* Xn) {
+                                       // Xn[Nx*Ny]
+    // Average the element values of channel c onto the nodes
+    for (int j = 0; j < Ny; j++) {
+      for (int i = 0; i < Nx; i++) {
+	float sum = 0.0;
+	int count = 0;
+	for (int q = std::max(j-1,0); q < std::min(j+1,Ey); q++) {
+	  for (int p = std::max(i-1,0); p < std::min(i+1,Ex); p++) {
+	    sum += field(p,q,c);
+	    count++;
+	  }
+	}
+	Xn[Nx*j+i] = sum / count;
+      }
+    }
+  } // ElementToNode
+
+  virtual ~Mesh() {
+    delete[] Vxn;
+    delete[] Vyn;
+    if (!aliased) delete[] He;
+    delete[] Re;
+    delete[] Rb;
+    delete[] Dk;
+    delete[] Dw;
+    delete[] Bk;
+    delete[] Bw;
+    delete[] Wn;
+    delete[] Un;
+    delete[] Ue;
+    delete[] Fn;
+    delete[] dUn;
+    delete[] Gn;
+    delete[] Ge;
+    delete[] Xp;
+    delete[] Xb;
+    delete[] Fxn;
+    delete[] Fyn;
+    delete[] Se;
+    delete[] Sn;
+    delete[] Cn;
+    delete spectral;
+  } // ~Mesh
+
+  // The arrays are owned (and He possibly aliased): no copies
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
+
+  bool Solid(int i, int j) {
+    return (Se[Bx*j+i/32] >> (i%32)) & 1;
+  } // Solid
+
+  void SetSolid(int i, int j, bool solid) {
+    // Mark element (i,j) as solid (or fluid); solid elements carry no
+    // pressure head, and their nodes carry no velocity
+    if (solid) {
+      Se[Bx*j+i/32] |= (1u << (i%32));
+      He[Ex*j+i] = 0.0;
+    } else {
+      Se[Bx*j+i/32] &= ~(1u << (i%32));
+    }
+    if (i/32 == Bx-1) PadSolids(j);
+    for (int q = j; q <= j+1; q++) {
+      for (int p = i; p <= i+1; p++) {
+	UpdateNode(p, q);
+      }
+    }
+  } // SetSolid
+
+  void LoadSolids(CImg<float>& image, int c) {
+    // Elements whose value in channel c is at least half of full scale
+    // (128 for 8-bit images) are solid
+    CheckSolids(image.width(), image.height());
     for (int j = 0; j < Ey; j++) {
       for (int i = 0; i < Ex; i++) {
-	He[Ex*j+i] = image(i,j,0)/256.0; // grid height initialization
+	SetSolid(i, j, image(i,j,0,c) >= 128.0);
       }
     }
-    Re  = new float[4*Ex*Ey];
-    Un  = new float[Nx*Ny];
-    Ue  = new float[Ex*Ey];
-    Fn  = new float[Nx*Ny];
-    dUn = new float[Nx*Ny];
-  } // Mesh
+  } // LoadSolids
 
-  void UpdateFields(float new_dt) {
+  void LoadSolids(Field& field, int c) {
+    // Elements whose value in channel c is at least 0.5 are solid
+    CheckSolids(field.width, field.height);
+    for (int j = 0; j < Ey; j++) {
+      for (int i = 0; i < Ex; i++) {
+	SetSolid(i, j, field(i,j,c) >= 0.5);
+      }
+    }
+  } // LoadSolids
+
+  void CheckSolids(int w, int h) {
+    // The obstacles must have one pixel per element
+    if ((w != Ex) || (h != Ey)) {
+      std::cerr << "Mesh: " << w << "x" << h << " obstacles do not match "
+                << Ex << "x" << Ey << " mesh" << std::endl;
+      exit(1);
+    }
+  } // CheckSolids
+
+  void PadSolids(void) {
+    // Pad the last tile of every row
+    for (int j = 0; j < Ey; j++) {
+      PadSolids(j);
+    }
+  } // PadSolids
+
+  void PadSolids(int j) {
+    // Mark the unused bits of the last tile of row j as solid while its
+    // elements are all solid (and clear them otherwise), so that a
+    // fully-solid tile is always stored as ~0, and the set bits of any other
+    // tile are elements of the row
+    if (Ex % 32 == 0) return;
+    const uint32_t valid = (1u << (Ex%32)) - 1;
+    uint32_t& last = Se[Bx*j+Bx-1];
+    last = ((last & valid) == valid) ? ~0u : (last & valid);
+  } // PadSolids
+
+  void EnableBodyForce(void) {
+    // Allocate the (zero) nodal body forces, which are added to the
+    // momentum equation at every step
+    if (Fxn != NULL) return;
+    Fxn = new float[Nx*Ny](); // zero initialization
+    Fyn = new float[Nx*Ny](); // zero initialization
+  } // EnableBodyForce
+
+  void EnableSpectralViscosity(bool enable) {
+    // Advance the viscous term exactly in Fourier space (at any time step)
+    // while both directions are periodic, or with the stencil
+    if (enable && (spectral == NULL)) {
+      spectral = new SpectralDiffusion(Ex, Ey, dx, dx);
+    } else if (!enable) {
+      delete spectral;
+      spectral = NULL;
+    }
+  } // EnableSpectralViscosity
+
+  void SetBoundary(int side, int type, float value = 0.0) {
+    // Periodic boundaries are set in pairs: making one side periodic makes
+    // the opposite side periodic, and vice versa
+    int opposite = side ^ 1;
+    bc[side] = type;
+    bv[side] = value;
+    if (type == PERIODIC) {
+      bc[opposite] = PERIODIC;
+      bv[opposite] = 0.0;
+    } else if (bc[opposite] == PERIODIC) {
+      bc[opposite] = NOSLIP;
+      bv[opposite] = 0.0;
+    }
+    UpdateLumpedMass();
+  } // SetBoundary
+
+  void UpdateLumpedMass(void) {
+    // Compute the inverse of the lumped (row-summed) mass matrix, and the
+    // solid and cut node masks
+    for (int k = 0; k < Bn*Ny; k++) {
+      Sn[k] = Cn[k] = 0;
+    }
+    if (Nx % 32) { // the unused bits of the last tile in each row are solid
+      for (int j = 0; j < Ny; j++) {
+	Sn[Bn*j+Bn-1] = ~((1u << (Nx%32)) - 1);
+      }
+    }
+    solidNodes = 0;
+    for (int j = 0; j < Ny; j++) {
+      for (int i = 0; i < Nx; i++) {
+	UpdateNode(i, j);
+      }
+    }
+  } // UpdateLumpedMass
+
+  void UpdateNode(int i, int j) {
+    // The lumped mass of node (i,j) is a quarter of the area of each fluid
+    // element around it (so that nodes on a non-periodic boundary carry
+    // half the mass of an interior node, and solid elements none); nodes
+    // with no fluid element around are solid, and take no part in the
+    // remap (they keep the mass of their solid elements, so that the
+    // inverse stays finite). Coincident periodic nodes are updated together
+    const bool px = (bc[LEFT] == PERIODIC);
+    const bool py = (bc[BOTTOM] == PERIODIC);
+    int fluid = 0, solid = 0;
+    for (int q = j-1; q <= j; q++) {
+      for (int p = i-1; p <= i; p++) {
+	int a = px ? (p + Ex) % Ex : p;
+	int b = py ? (q + Ey) % Ey : q;
+	if ((a < 0) || (a >= Ex) || (b < 0) || (b >= Ey)) continue;
+	if (Solid(a, b)) solid++; else fluid++;
+      }
+    }
+    const float m = 0.25*((fluid > 0) ? fluid : solid);
+    const int xs[2] = { i, (!px) ? -1 : (i == 0) ? Nx-1 : (i == Nx-1) ? 0 : -1 };
+    const int ys[2] = { j, (!py) ? -1 : (j == 0) ? Ny-1 : (j == Ny-1) ? 0 : -1 };
+    for (int y = 0; y < 2; y++) {
+      for (int x = 0; x < 2; x++) {
+	const int p = xs[x], q = ys[y];
+	if ((p < 0) || (q < 0)) continue;
+	uint32_t bit = 1u << (p%32);
+	uint32_t& sn = Sn[Bn*q+p/32];
+	uint32_t& cn = Cn[Bn*q+p/32];
+	solidNodes -= (sn & bit) ? 1 : 0;
+	sn = (fluid == 0) ? (sn | bit) : (sn & ~bit);
+	cn = ((fluid > 0) && (solid > 0)) ? (cn | bit) : (cn & ~bit);
+	solidNodes += (fluid == 0) ? 1 : 0;
+	Wn[Nx*q+p] = 1.0/(m*dx*dx);
+      }
+    }
+  } // UpdateNode
+
+  uint64_t Hash(void) {
+    // Fingerprint of the exact bits of the velocities and the pressure head
+    uint64_t h = Hash64(Vxn, Nx*Ny*sizeof(float));
+    h = Hash64(Vyn, Nx*Ny*sizeof(float), h);
+    return Hash64(He, Ex*Ey*sizeof(float), h);
+  } // Hash
+
+  virtual void UpdateFields(float new_dt) {
+    // Advance the fields, with run-time dimensions
+    Update(new_dt);
+  } // UpdateFields
+
+  template<int EX = 0, int EY = 0>
+  void Update(float new_dt) {
     // Update the time step
     dt = new_dt;
 
+    // The velocities decay into denormals in the quiet corners of a cavity,
+    // which double the cost of a step: flush them (the threads of the
+    // kernels inherit the control register), here rather than in the
+    // callers, so that the app, the benchmarks and the ensemble all take
+    // the same steps
+    FlushDenormals flush;
+
     // Form the integral operator
-    UpdateIntegralOperator();
+    UpdateIntegralOperator<EX,EY>();
 
     // Update velocity field
-    UpdateNodalField(Vxn);
-    UpdateNodalField(Vyn);
-    UpdateMomentum();
+    UpdateNodalField<EX,EY>(Vxn);
+    UpdateNodalField<EX,EY>(Vyn);
+    UpdateMomentum<EX,EY>();
 
     // Update pressure head field
-    UpdateElementField(He);
+    UpdateElementField<EX,EY>(He);
 
     // Enforce BCs
-    EnforceNodalBCs();
-  } // UpdateFields
+    EnforceNodalBCs<EX,EY>();
+  } // Update
 
+  template<int EX = 0, int EY = 0>
   void UpdateIntegralOperator(void) {
-    const float scale = 0.5*dt/dx;
-    float w, xi, eta;
-    for (int j = 0; j < Ey; j++) {
-      for (int i = 0; i < Ex; i++) {
-	int e = Ex*j+i;
-	w = 0.25*dx*dx*(1.0+scale*(-Vxn[Nx*j+i]      -Vyn[Nx*j+i]
-                                   +Vxn[Nx*j+i+1]    -Vyn[Nx*j+i+1]
-                                   +Vxn[Nx*(j+1)+i+1]+Vyn[Nx*(j+1)+i+1]
-				   -Vxn[Nx*(j+1)+i]  +Vyn[Nx*(j+1)+i]));
-	xi  = scale*(Vxn[Nx*j+i]
-                    +Vxn[Nx*j+i+1]
-                    +Vxn[Nx*(j+1)+i+1]
-		    +Vxn[Nx*(j+1)+i]);
-	eta = scale*(Vyn[Nx*j+i]
-                    +Vyn[Nx*j+i+1]
-                    +Vyn[Nx*(j+1)+i+1]
-		    +Vyn[Nx*(j+1)+i]);
-	Re[4*e]   = w*(1.0-xi)*(1.0-eta);
-	Re[4*e+1] = w*(1.0+xi)*(1.0-eta);
-	Re[4*e+2] = w*(1.0+xi)*(1.0+eta);
-	Re[4*e+3] = w*(1.0-xi)*(1.0+eta);
+    // Form the integral operator of the remap over dt (or the departure
+    // points of the backtrace), and the one over -dt for the corrected
+    // remaps
+    const int P = Nx*Ny + Ex*Ey;
+    if (engine == SEMI_LAGRANGIAN) {
+      if (Dk == NULL) {
+	Dk = new int[P];
+	Dw = new float[2*P];
+      }
+      Backtrace<EX,EY>(Dk, Dw, dt);
+    } else {
+      IntegralOperator<EX,EY>(Re, dt);
+    }
+    if (correction != FIRST_ORDER) {
+      if (Xp == NULL) {
+	Xp = new float[Nx*Ny];
+	Xb = new float[Nx*Ny];
+      }
+      if (engine == SEMI_LAGRANGIAN) {
+	if (Bk == NULL) {
+	  Bk = new int[P];
+	  Bw = new float[2*P];
+	}
+	Backtrace<EX,EY>(Bk, Bw, -dt);
+      } else {
+	if (Rb == NULL) Rb = new float[4*Ex*Ey];
+	IntegralOperator<EX,EY>(Rb, -dt);
       }
     }
   } // UpdateIntegralOperator
 
+  template<int EX = 0, int EY = 0>
+  void IntegralOperator(float* R, float tau) {
+                       // R[4*Ex*Ey]
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey;                    // for fixed-size meshes
+
+    const int bx = (ex+31)/32;                      // tiles per row
+
+    const float scale = 0.5*tau/dx;
+    float w, xi, eta;
+    for (int j = 0; j < ey; j++) {
+      for (int t = 0; t < bx; t++) {
+	if (Se[bx*j+t] == ~0u) continue; // skip fully-solid tiles
+	for (int i = 32*t; i < std::min(32*t+32,ex); i++) {
+	  int e = ex*j+i;
+	  w = 0.25*dx*dx*(1.0+scale*(-Vxn[nx*j+i]      -Vyn[nx*j+i]
+                                     +Vxn[nx*j+i+1]    -Vyn[nx*j+i+1]
+                                     +Vxn[nx*(j+1)+i+1]+Vyn[nx*(j+1)+i+1]
+				     -Vxn[nx*(j+1)+i]  +Vyn[nx*(j+1)+i]));
+	  xi  = scale*(Vxn[nx*j+i]
+                      +Vxn[nx*j+i+1]
+                      +Vxn[nx*(j+1)+i+1]
+		      +Vxn[nx*(j+1)+i]);
+	  eta = scale*(Vyn[nx*j+i]
+                      +Vyn[nx*j+i+1]
+                      +Vyn[nx*(j+1)+i+1]
+		      +Vyn[nx*(j+1)+i]);
+	  R[4*e]   = w*(1.0-xi)*(1.0-eta);
+	  R[4*e+1] = w*(1.0+xi)*(1.0-eta);
+	  R[4*e+2] = w*(1.0+xi)*(1.0+eta);
+	  R[4*e+3] = w*(1.0-xi)*(1.0+eta);
+	}
+      }
+    }
+  } // IntegralOperator
+
+  template<int EX = 0, int EY = 0>
   void UpdateNodalField(float* Xn) {
                      // Xn[Nx*Ny]
-    Interpolate(Xn, Ue);
-    Integrate(Ue); Remap(Xn);
+    if ((correction == FIRST_ORDER) || (Xp == NULL)) {
+      RemapNodalField<EX,EY>(Xn);
+    } else {
+      CorrectedRemap<EX,EY,true>(Xn);
+    }
   } // UpdateNodalField
 
+  template<int EX = 0, int EY = 0>
   void UpdateElementField(float* Xe) {
-                       // Xe[Nx*Ny]
-    Integrate(Xe); Remap(Un);
-    Interpolate(Un, Xe);
+                       // Xe[Ex*Ey]
+    if ((correction == FIRST_ORDER) || (Xp == NULL)) {
+      RemapElementField<EX,EY>(Xe);
+    } else {
+      CorrectedRemap<EX,EY,false>(Xe);
+    }
   } // UpdateElementField
 
-  void EnforceNodalBCs(void) {
-    // Enforce tangential velocity BCs
-    float v = 5.0;
-    for (int j = 0; j < Ny; j++) {
-      Vyn[Nx*j]        = -v;
-      Vyn[Nx*j+(Nx-1)] = +v;
-    }
-    for (int i = 0; i < Nx; i++) {
-      Vxn[i]           = +v;
-      Vxn[Nx*(Ny-1)+i] = -v;
+  template<int EX = 0, int EY = 0>
+  void RemapNodalField(float* Xn) {
+                    // Xn[Nx*Ny]
+    if (engine == SEMI_LAGRANGIAN) {
+      memcpy(Un, Xn, Nx*Ny*sizeof(float));
+      Sample(Xn, Un, Dk, Dw, Dw + (Nx*Ny + Ex*Ey), Nx*Ny, Nx);
+      return;
     }
-    // Enforce zero normal velocity BCs
-    for (int j = 0; j < Ny; j++) {
-      Vxn[Nx*j]        = 0.0;
-      Vxn[Nx*j+(Nx-1)] = 0.0;
-    }
-    for (int i = 0; i < Nx; i++) {
-      Vyn[i]           = 0.0;
-      Vyn[Nx*(Ny-1)+i] = 0.0;
+    Interpolate<EX,EY>(Xn, Ue);
+    Integrate<EX,EY>(Ue); Remap<EX,EY>(Xn);
+  } // RemapNodalField
+
+  template<int EX = 0, int EY = 0>
+  void RemapElementField(float* Xe) {
+                      // Xe[Ex*Ey]
+    if (engine == SEMI_LAGRANGIAN) {
+      const int P = Nx*Ny + Ex*Ey;
+      FillElementGhosts<EX,EY>(Xe);
+      Sample(Xe, Ge, Dk + Nx*Ny, Dw + Nx*Ny, Dw + P + Nx*Ny, Ex*Ey, Ex+2);
+      ClearSolids(Xe);
+      return;
     }
-  } // EnforceNodalBCs
+    Integrate<EX,EY>(Xe); Remap<EX,EY>(Un);
+    Interpolate<EX,EY>(Un, Xe);
+  } // RemapElementField
 
-  void UpdateMomentum(void) {
-    // Update momentum equation
-    float v = 0.01; // kinematic viscosity
-    float flux = v * dt / (dx*dx);
-    float force = - dt / dx;
+  template<int EX = 0, int EY = 0, bool NODAL = false>
+  void CorrectedRemap(float* X) {
+                   // X[Nx*Ny] (NODAL) or X[Ex*Ey]
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+    const int cols = NODAL ? nx : ex;
+    const int rows = NODAL ? ny : ey;
 
-    // Compute x-momentum change
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 0; i < Nx; i++) {
-	dUn[Nx*j+i] = - 4.0 * Vxn[Nx*j+i];
+    // Estimate the error of the remap A by remapping forward and back:
+    // A'(A(X)) - X is twice the error (A' is the remap over -dt), and the
+    // error is compensated either after the forward remap (MacCormack),
+    // X <- A(X) + (X - A'(A(X)))/2, or before a second one (BFECC),
+    // X <- A(X + (X - A'(A(X)))/2)
+    memcpy(Xp, X, cols*rows*sizeof(float));
+    if (NODAL) RemapNodalField<EX,EY>(X); else RemapElementField<EX,EY>(X);
+    memcpy(Xb, X, cols*rows*sizeof(float));
+    std::swap(Re, Rb); std::swap(Dk, Bk); std::swap(Dw, Bw);
+    if (NODAL) RemapNodalField<EX,EY>(Xb); else RemapElementField<EX,EY>(Xb);
+    std::swap(Re, Rb); std::swap(Dk, Bk); std::swap(Dw, Bw);
+    if (correction == MACCORMACK) {
+      for (int k = 0; k < cols*rows; k++) {
+	X[k] += 0.5*(Xp[k] - Xb[k]);
       }
-    }
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 1; i < Nx; i++) {
-	dUn[Nx*j+i] += Vxn[Nx*j+i-1];
+    } else {
+      for (int k = 0; k < cols*rows; k++) {
+	X[k] = 1.5*Xp[k] - 0.5*Xb[k];
       }
+      if (NODAL) RemapNodalField<EX,EY>(X); else RemapElementField<EX,EY>(X);
     }
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 0; i < (Nx-1); i++) {
-	dUn[Nx*j+i] += Vxn[Nx*j+i+1];
+    if (engine == SEMI_LAGRANGIAN) {
+      // the extrema of the samples of each departure point
+      if (NODAL) {
+	LimitStencil(X, Xp, Dk, nx*ny, nx);
+      } else {
+	FillElementGhosts<EX,EY>(Xp);
+	LimitStencil(X, Ge, Dk + nx*ny, ex*ey, ex+2);
       }
+    } else {
+      Limit(X, Xp, cols, rows, Xb);
     }
-    for (int j = 1; j < Ny; j++) {
-      for (int i = 0; i < Nx; i++) {
-	dUn[Nx*j+i] += Vxn[Nx*(j-1)+i];
+  } // CorrectedRemap
+
+  void Limit(float* X, const float* X0, int nx, int ny, float* w) {
+          // X[nx*ny], X0[nx*ny], w[2*nx]
+    // Clamp X to the extrema of X0 over the 3x3 neighborhood of each entry
+    // (the cells the remap draws from, for Courant numbers up to 1), so that
+    // the correction creates no new extrema; w holds the extrema of the
+    // three rows around the current one
+    float* lo = w;
+    float* hi = w + nx;
+    for (int j = 0; j < ny; j++) {
+      const float* s = X0 + nx*std::max(j-1, 0);
+      const float* c = X0 + nx*j;
+      const float* t = X0 + nx*std::min(j+1, ny-1);
+      for (int i = 0; i < nx; i++) {
+	lo[i] = std::min(std::min(s[i], c[i]), t[i]);
+	hi[i] = std::max(std::max(s[i], c[i]), t[i]);
       }
-    }
-    for (int j = 0; j < (Ny-1); j++) {
-      for (int i = 0; i < Nx; i++) {
-	dUn[Nx*j+i] += Vxn[Nx*(j+1)+i];
+      float* x = X + nx*j;
+      x[0] = std::min(std::max(x[0], std::min(lo[0], lo[1])), std::max(hi[0], hi[1]));
+      for (int i = 1; i < nx-1; i++) {
+	float a = std::min(std::min(lo[i-1], lo[i]), lo[i+1]);
+	float b = std::max(std::max(hi[i-1], hi[i]), hi[i+1]);
+	x[i] = std::min(std::max(x[i], a), b);
       }
+      x[nx-1] = std::min(std::max(x[nx-1], std::min(lo[nx-2], lo[nx-1])),
+                         std::max(hi[nx-2], hi[nx-1]));
     }
-    for (int i = 0; i < Nx*Ny; i++) {
-      Vxn[i] += flux * dUn[i];
+  } // Limit
+
+  void LimitStencil(float* X, const float* S, const int* K, int n, int stride) {
+                 // X[n], K[n]
+    // Clamp X to the extrema of the four samples of S around each
+    // departure point (at any Courant number)
+    for (int k = 0; k < n; k++) {
+      const float* s = S + K[k];
+      float a = std::min(std::min(s[0], s[1]), std::min(s[stride], s[stride+1]));
+      float b = std::max(std::max(s[0], s[1]), std::max(s[stride], s[stride+1]));
+      X[k] = std::min(std::max(X[k], a), b);
     }
-    // Add x-forces due to pressure head gradient
-    for (int j = 1; j < (Ny-1); j++) {
-      for (int i = 1; i < (Nx-1); i++) {
-	Vxn[Nx*j+i] += 0.5 * force * (He[Nx*j+i]    -He[Nx*j+i-1]
-                                     +He[Nx*(j-1)+i]-He[Nx*(j-1)+i-1]);
+  } // LimitStencil
+
+  template<int EX = 0, int EY = 0>
+  void Backtrace(int* K, float* W, float tau) {
+                // K[Nx*Ny+Ex*Ey], W[2*(Nx*Ny+Ex*Ey)]
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+    const int P = nx*ny + ex*ey;
+    const int Hx = ex + 2; // row stride of Ge
+
+    // Trace the nodes and element centers back over tau (in node units),
+    // with the midpoint rule, and store the bilinear stencils of their
+    // departure points: within the nodes (wrapped across periodic sides,
+    // clamped to the others), and within the element centers of Ge (whose
+    // ghost layer wraps around or mirrors the sides). Each pass is a plain
+    // loop over the points, without branches or calls, which the compiler
+    // vectorizes; the velocities at the midpoints are sampled (into Fn and
+    // dUn) like any field
+    const float c = tau / dx;
+    const int px = (bc[LEFT] == PERIODIC);   // (flags as ints: the vectorizer
+    const int py = (bc[BOTTOM] == PERIODIC); // gives up on selects on bools)
+
+    // nodes
+    int* Kn = K;
+    float* xn = W;
+    float* yn = W + P;
+    for (int j = 0; j < ny; j++) {
+      for (int i = 0; i < nx; i++) {
+	int n = nx*j+i;
+	xn[n] = Wrap(i - 0.5f*c*Vxn[n], ex, px);
+	yn[n] = Wrap(j - 0.5f*c*Vyn[n], ey, py);
       }
     }
-    for (int j = 0; j < 1; j++) {
-      for (int i = 1; i < (Nx-1); i++) {
-	Vxn[Nx*j+i] += force * (He[Nx*j+i]-He[Nx*j+i-1]);
+    Locate(Kn, xn, yn, nx*ny, ex-1, ey-1, nx);
+    Sample(Fn,  Vxn, Kn, xn, yn, nx*ny, nx);
+    Sample(dUn, Vyn, Kn, xn, yn, nx*ny, nx);
+    for (int j = 0; j < ny; j++) {
+      for (int i = 0; i < nx; i++) {
+	int n = nx*j+i;
+	xn[n] = Wrap(i - c*Fn[n],  ex, px);
+	yn[n] = Wrap(j - c*dUn[n], ey, py);
       }
     }
-    for (int j = (Ny-1); j < Ny; j++) {
-      for (int i = 1; i < (Nx-1); i++) {
-	Vxn[Nx*j+i] += force * (He[Nx*(j-1)+i]-He[Nx*(j-1)+i-1]);
+    Locate(Kn, xn, yn, nx*ny, ex-1, ey-1, nx);
+
+    // element centers
+    int* Ke = K + nx*ny;
+    float* xe = W + nx*ny;
+    float* ye = W + P + nx*ny;
+    for (int j = 0; j < ey; j++) {
+      const float* u0 = Vxn + nx*j;
+      const float* u1 = u0 + nx;
+      const float* v0 = Vyn + nx*j;
+      const float* v1 = v0 + nx;
+      for (int i = 0; i < ex; i++) {
+	int e = ex*j+i;
+	float u = 0.25f*(u0[i] + u0[i+1] + u1[i] + u1[i+1]);
+	float v = 0.25f*(v0[i] + v0[i+1] + v1[i] + v1[i+1]);
+	xe[e] = Wrap(i + 0.5f - 0.5f*c*u, ex, px);
+	ye[e] = Wrap(j + 0.5f - 0.5f*c*v, ey, py);
       }
     }
-    
-    // Compute y-momentum change
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 0; i < Nx; i++) {
-	dUn[Nx*j+i] = - 4.0 * Vyn[Nx*j+i];
+    Locate(Ke, xe, ye, ex*ey, ex-1, ey-1, nx);
+    Sample(Fn,  Vxn, Ke, xe, ye, ex*ey, nx);
+    Sample(dUn, Vyn, Ke, xe, ye, ex*ey, nx);
+    const float x0 = px ? -0.5f : 0.5f, x1 = px ? ex + 0.5f : ex - 0.5f; // (no-ops
+    const float y0 = py ? -0.5f : 0.5f, y1 = py ? ey + 0.5f : ey - 0.5f; // if periodic)
+    for (int j = 0; j < ey; j++) {
+      for (int i = 0; i < ex; i++) {
+	// element (i,j) is at (i+1,j+1) in Ge, its center at (i+1.5,j+1.5):
+	// the departure points are clamped to the centers next to walls, and
+	// shifted by 1/2 as they are located (an addition after the selects
+	// would be moved into their branches, and stop the vectorization)
+	int e = ex*j+i;
+	float x = Wrap(i + 0.5f - c*Fn[e],  ex, px);
+	float y = Wrap(j + 0.5f - c*dUn[e], ey, py);
+	xe[e] = std::min(std::max(x, x0), x1);
+	ye[e] = std::min(std::max(y, y0), y1);
       }
     }
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 1; i < Nx; i++) {
-	dUn[Nx*j+i] += Vyn[Nx*j+i-1];
+    Locate(Ke, xe, ye, ex*ey, ex, ey, Hx, 0.5f);
+  } // Backtrace
+
+  static float Floor(float x) {
+    // Round down (for |x| < 2^31), without a call to the math library, and
+    // with the correction in integers (a conditional float subtraction may
+    // trap, and is not if-converted)
+    int i = int(x);
+    return float(i - (float(i) > x));
+  } // Floor
+
+  static float Wrap(float x, int n, int periodic) {
+    // Map a node coordinate into [0,n) across a periodic side, or clamp it
+    // to [0,n] (both are computed, and one selected)
+    float w = x - n * Floor(x / n);
+    w = (w < n) ? w : 0.0f;
+    float c = std::min(std::max(x, 0.0f), float(n));
+    return periodic ? w : c;
+  } // Wrap
+
+  void Locate(int* K, float* x, float* y, int n, int mx, int my, int stride,
+              float shift = 0.0f) {
+            // K[n], x[n], y[n]
+    // Replace the coordinates of n points (shifted along x and y) by their
+    // bilinear stencils: the first sample (the cell, up to (mx,my), of a
+    // grid with the stride), and the fractions of the cell
+    for (int k = 0; k < n; k++) {
+      float xk = x[k] + shift, yk = y[k] + shift;
+      int i = std::min(int(xk), mx), j = std::min(int(yk), my);
+      K[k] = stride*j+i;
+      x[k] = xk - i;
+      y[k] = yk - j;
+    }
+  } // Locate
+
+  void Sample(float* X, const float* S, const int* K, const float* wx, const float* wy,
+              int n, int stride) {
+           // X[n], K[n], wx[n], wy[n]
+    // Sample S bilinearly at n departure points: X[k] interpolates
+    // S[K[k]], S[K[k]+1], S[K[k]+stride] and S[K[k]+stride+1]
+    int k = 0;
+#ifdef MESH_GATHER
+    if (gather) k = SampleGather(X, S, K, wx, wy, n, stride);
+#endif
+    for (; k < n; k++) {
+      const float* s = S + K[k];
+      float lo = s[0]      + wx[k]*(s[1]        - s[0]);
+      float hi = s[stride] + wx[k]*(s[stride+1] - s[stride]);
+      X[k] = lo + wy[k]*(hi - lo);
+    }
+  } // Sample
+
+#ifdef MESH_GATHER
+  __attribute__((target("avx2")))
+  int SampleGather(float* X, const float* S, const int* K, const float* wx, const float* wy,
+                   int n, int stride) {
+    // Sample 8 departure points at a time, with 4 gathers (one per corner
+    // of the stencils), returning the number of points sampled. The lanes
+    // round exactly as the scalar loop of Sample does (a subtraction, a
+    // multiplication and an addition, with no fused multiply-adds, which
+    // the target excludes), so that the fields, and their hashes, do not
+    // depend on whether the CPU has gathers
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i row = _mm256_set1_epi32(stride);
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+      __m256i k00 = _mm256_loadu_si256((const __m256i*)(K + k));
+      __m256i k01 = _mm256_add_epi32(k00, row);
+      __m256 s00 = _mm256_i32gather_ps(S, k00, 4);
+      __m256 s10 = _mm256_i32gather_ps(S, _mm256_add_epi32(k00, one), 4);
+      __m256 s01 = _mm256_i32gather_ps(S, k01, 4);
+      __m256 s11 = _mm256_i32gather_ps(S, _mm256_add_epi32(k01, one), 4);
+      __m256 fx = _mm256_loadu_ps(wx + k);
+      __m256 fy = _mm256_loadu_ps(wy + k);
+      __m256 lo = _mm256_add_ps(s00, _mm256_mul_ps(fx, _mm256_sub_ps(s10, s00)));
+      __m256 hi = _mm256_add_ps(s01, _mm256_mul_ps(fx, _mm256_sub_ps(s11, s01)));
+      _mm256_storeu_ps(X + k, _mm256_add_ps(lo, _mm256_mul_ps(fy, _mm256_sub_ps(hi, lo))));
+    }
+    return k;
+  } // SampleGather
+#endif
+
+  void ClearSolids(float* Xe) {
+                // Xe[Ex*Ey]
+    // Solid elements carry no value
+    for (int j = 0; j < Ey; j++) {
+      for (int t = 0; t < Bx; t++) {
+	uint32_t solid = Se[Bx*j+t];
+	if (solid == ~0u) solid = (Ex%32 && t == Bx-1) ? (1u << (Ex%32)) - 1 : ~0u;
+	for (; solid != 0; solid &= solid - 1) {
+	  Xe[Ex*j+32*t+__builtin_ctz(solid)] = 0.0;
+	}
       }
     }
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 0; i < (Nx-1); i++) {
-	dUn[Nx*j+i] += Vyn[Nx*j+i+1];
+  } // ClearSolids
+
+  template<int EX = 0, int EY = 0>
+  void FillElementGhosts(const float* Xe) {
+                      // Xe[Ex*Ey], Ge[(Ex+2)*(Ey+2)]
+    const int ex = EX ? EX : Ex;                    // compile-time constants
+    const int ey = EY ? EY : Ey;                    // for fixed-size meshes
+
+    // Copy Xe into Ge, whose ghost layer mirrors the adjacent elements (zero
+    // normal gradient) on all but periodic boundaries
+    Pad(Ge, Xe, ex, ey);
+    FillGhosts(Ge, ex, ey, false, 1.0);
+  } // FillElementGhosts
+
+  static void Pad(float* G, const float* X, int nx, int ny) {
+                 // G[(nx+2)*(ny+2)], X[nx*ny]
+    // Copy X into the interior of G (see FillGhosts)
+    for (int j = 0; j < ny; j++) {
+      memcpy(G + (nx+2)*(j+1) + 1, X + nx*j, nx*sizeof(float));
+    }
+  } // Pad
+
+  void FillGhosts(float* G, int nx, int ny, bool nodal, float a) {
+                 // G[(nx+2)*(ny+2)]
+    // Fill in the ghost layer of G, an nx x ny field padded by one row and
+    // column on each side, so that the stencils need no boundary cases:
+    // periodic boundaries wrap around (nodal fields over nx-1 nodes, as the
+    // last node coincides with the first, element fields over nx elements),
+    // all other boundaries repeat the adjacent row or column scaled by a.
+    // The rows are filled after the columns, so that the corners are scaled
+    // twice. This is the only place where the stencils meet the boundaries,
+    // and it costs O(nx + ny)
+    const int gx = nx + 2;
+    const int px = (bc[LEFT] == PERIODIC)   ? nx - nodal : 0; // periods,
+    const int py = (bc[BOTTOM] == PERIODIC) ? ny - nodal : 0; // or 0
+    for (int j = 1; j <= ny; j++) {
+      float* g = G + gx*j;
+      g[0]    = px ? g[px]      : (a == 0.0) ? 0.0 : a * g[1];
+      g[nx+1] = px ? g[nx+1-px] : (a == 0.0) ? 0.0 : a * g[nx];
+    }
+    for (int side = 0; side < 2; side++) {
+      float* g = G + gx*(side ? ny+1 : 0);
+      const float* h = G + gx*(side ? (py ? ny+1-py : ny) : (py ? py : 1));
+      for (int i = 0; i < gx; i++) {
+	g[i] = py ? h[i] : (a == 0.0) ? 0.0 : a * h[i];
       }
     }
-    for (int j = 1; j < Ny; j++) {
-      for (int i = 0; i < Nx; i++) {
-	dUn[Nx*j+i] += Vyn[Nx*(j-1)+i];
+  } // FillGhosts
+
+  template<int EX = 0, int EY = 0>
+  void EnforceNodalBCs(void) {
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+
+    // Enforce tangential velocity BCs
+    EnforceTangentialBC(bc[LEFT],   -bv[LEFT],   Vyn, 0,          nx, ny, +1);
+    EnforceTangentialBC(bc[RIGHT],  +bv[RIGHT],  Vyn, nx-1,       nx, ny, -1);
+    EnforceTangentialBC(bc[BOTTOM], +bv[BOTTOM], Vxn, 0,          1,  nx, +nx);
+    EnforceTangentialBC(bc[TOP],    -bv[TOP],    Vxn, nx*(ny-1),  1,  nx, -nx);
+
+    // Enforce normal velocity BCs
+    EnforceNormalBC(bc[LEFT],   +bv[LEFT],   Vxn, 0,          nx, ny, +1);
+    EnforceNormalBC(bc[RIGHT],  -bv[RIGHT],  Vxn, nx-1,       nx, ny, -1);
+    EnforceNormalBC(bc[BOTTOM], +bv[BOTTOM], Vyn, 0,          1,  nx, +nx);
+    EnforceNormalBC(bc[TOP],    -bv[TOP],    Vyn, nx*(ny-1),  1,  nx, -nx);
+
+    // Enforce periodicity (the last nodes coincide with the first nodes)
+    if (bc[LEFT] == PERIODIC) {
+      for (int j = 0; j < ny; j++) {
+	Vxn[nx*j+(nx-1)] = Vxn[nx*j];
+	Vyn[nx*j+(nx-1)] = Vyn[nx*j];
       }
     }
-    for (int j = 0; j < (Ny-1); j++) {
-      for (int i = 0; i < Nx; i++) {
-	dUn[Nx*j+i] += Vyn[Nx*(j+1)+i];
+    if (bc[BOTTOM] == PERIODIC) {
+      memcpy(Vxn+nx*(ny-1), Vxn, nx*sizeof(float));
+      memcpy(Vyn+nx*(ny-1), Vyn, nx*sizeof(float));
+    }
+
+    // Enforce no-slip BCs on the faces of solid elements
+    const int bx = (ex+31)/32;
+    for (int j = 0; j < ey; j++) {
+      for (int t = 0; t < bx; t++) {
+	for (uint32_t solid = Se[bx*j+t]; solid != 0; solid &= solid - 1) {
+	  int i = 32*t + __builtin_ctz(solid);
+	  if (i >= ex) break;
+	  Vxn[nx*j+i]       = Vyn[nx*j+i]       = 0.0;
+	  Vxn[nx*j+i+1]     = Vyn[nx*j+i+1]     = 0.0;
+	  Vxn[nx*(j+1)+i]   = Vyn[nx*(j+1)+i]   = 0.0;
+	  Vxn[nx*(j+1)+i+1] = Vyn[nx*(j+1)+i+1] = 0.0;
+	}
+      }
+    }
+  } // EnforceNodalBCs
+
+  void EnforceTangentialBC(int type, float v, float* Vn, int first, int stride, int count, int inward) {
+    // Set the tangential velocity Vn on the count boundary nodes starting at
+    // node first; the adjacent interior nodes are offset by inward
+    for (int k = first; k < first + stride*count; k += stride) {
+      switch (type) {
+      case NOSLIP:   Vn[k] = v;           break;
+      case FREESLIP: Vn[k] = Vn[k+inward]; break;
+      case INFLOW:   Vn[k] = 0.0;         break;
+      case OUTFLOW:  Vn[k] = Vn[k+inward]; break;
+      default:                             break;
       }
     }
-    for (int i = 0; i < Nx*Ny; i++) {
-      Vyn[i] += flux * dUn[i];
+  } // EnforceTangentialBC
+
+  void EnforceNormalBC(int type, float v, float* Vn, int first, int stride, int count, int inward) {
+    // Set the (inward) normal velocity Vn on the count boundary nodes
+    // starting at node first; the adjacent interior nodes are offset by inward
+    for (int k = first; k < first + stride*count; k += stride) {
+      switch (type) {
+      case NOSLIP:   Vn[k] = 0.0;         break;
+      case FREESLIP: Vn[k] = 0.0;         break;
+      case INFLOW:   Vn[k] = v;           break;
+      case OUTFLOW:  Vn[k] = Vn[k+inward]; break;
+      default:                             break;
+      }
     }
-    // Add y-forces due to pressure head gradient
-    for (int j = 1; j < (Ny-1); j++) {
-      for (int i = 1; i < (Nx-1); i++) {
-	Vyn[Nx*j+i] += 0.5 * force * (He[Nx*j+i]  -He[Nx*(j-1)+i]
-                                     +He[Nx*j+i-1]-He[Nx*(j-1)+i-1]);
+  } // EnforceNormalBC
+
+  template<int EX = 0, int EY = 0>
+  void UpdateMomentum(void) {
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+    const int Gx = nx + 2; // row stride of Gn
+    const int Hx = ex + 2; // row stride of Ge
+
+    // Update momentum equation (on a doubly-periodic mesh, the viscous term
+    // may be split off, and advanced exactly in Fourier space)
+    float v = viscosity;
+    const bool exact = (spectral != NULL) && (bc[LEFT] == PERIODIC) && (bc[BOTTOM] == PERIODIC);
+    float flux = exact ? 0.0 : v * dt / (dx*dx);
+    float force = - dt / dx;
+
+    // Pad the pressure head with its ghost layer
+    FillElementGhosts<EX,EY>(He);
+
+    // Compute x-momentum change (from the old velocities, padded with zero
+    // ghosts, as the velocities are updated in place)
+    Pad(Gn, Vxn, nx, ny);
+    FillGhosts(Gn, nx, ny, true, 0.0);
+    for (int j = 0; j < ny; j++) {
+      const float* g = Gn + Gx*(j+1) + 1;
+      const float* h = Ge + Hx*j;
+      for (int i = 0; i < nx; i++) {
+	// viscous diffusion
+	Vxn[nx*j+i] += flux * (g[i-1]+g[i+1]+g[i-Gx]+g[i+Gx] - 4.0 * g[i]);
+	// forces due to pressure head gradient
+	Vxn[nx*j+i] += 0.5 * force * (h[Hx+i+1]-h[Hx+i]
+                                     +h[i+1]   -h[i]);
       }
     }
-    for (int j = 1; j < (Ny-1); j++) {
-      for (int i = 0; i < 1; i++) {
-	Vyn[Nx*j+i] += force * (He[Nx*j+i]-He[Nx*(j-1)+i]);
+
+    // Compute y-momentum change
+    Pad(Gn, Vyn, nx, ny);
+    FillGhosts(Gn, nx, ny, true, 0.0);
+    for (int j = 0; j < ny; j++) {
+      const float* g = Gn + Gx*(j+1) + 1;
+      const float* h = Ge + Hx*j;
+      for (int i = 0; i < nx; i++) {
+	// viscous diffusion
+	Vyn[nx*j+i] += flux * (g[i-1]+g[i+1]+g[i-Gx]+g[i+Gx] - 4.0 * g[i]);
+	// forces due to pressure head gradient
+	Vyn[nx*j+i] += 0.5 * force * (h[Hx+i+1]-h[i+1]
+                                     +h[Hx+i]  -h[i]);
       }
     }
-    for (int j = 1; j < (Ny-1); j++) {
-      for (int i = (Nx-1); i < Nx; i++) {
-	Vyn[Nx*j+i] += force * (He[Nx*j+i-1]-He[Nx*(j-1)+i-1]);
+
+    // Add the body forces
+    if (Fxn != NULL) {
+      for (int n = 0; n < nx*ny; n++) {
+	Vxn[n] += dt * Fxn[n];
+	Vyn[n] += dt * Fyn[n];
       }
     }
+
+    // Diffuse both velocity components over the distinct (Ex x Ey) nodes
+    // at once; the periodic copies are restored with the BCs
+    if (exact) {
+      spectral->Apply(Vxn, Vyn, nx, v * dt);
+    }
   } // UpdateMomentum
 
+  template<int EX = 0, int EY = 0>
   void Interpolate(float* Xn, float* Xe) {
                 // Xn[Nx*Ny], Xe[Ex*Ey]
-    for (int j = 0; j < Ey; j++) {
-      for (int i = 0; i < Ex; i++) {
-	Xe[Ex*j+i] = 0.25*(Xn[Nx*j+i]
-                          +Xn[Nx*j+i+1]
-                          +Xn[Nx*(j+1)+i+1]
-                          +Xn[Nx*(j+1)+i]);
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey;                    // for fixed-size meshes
+    const int bx = (ex+31)/32;                      // tiles per row
+
+    for (int j = 0; j < ey; j++) {
+      for (int t = 0; t < bx; t++) {
+	uint32_t solid = Se[bx*j+t];
+	int i1 = std::min(32*t+32,ex);
+	if (solid == ~0u) { // fully-solid tile: no value
+	  memset(Xe+ex*j+32*t, 0, (i1-32*t)*sizeof(float));
+	  continue;
+	}
+	for (int i = 32*t; i < i1; i++) {
+	  Xe[ex*j+i] = 0.25*(Xn[nx*j+i]
+                            +Xn[nx*j+i+1]
+                            +Xn[nx*(j+1)+i+1]
+                            +Xn[nx*(j+1)+i]);
+	}
+	for (; solid != 0; solid &= solid - 1) { // partially-solid tile
+	  Xe[ex*j+32*t+__builtin_ctz(solid)] = 0.0;
+	}
       }
     }
   } // Interpolate
 
+  template<int EX = 0, int EY = 0>
   void Integrate(float* Xe) {
               // Xe[Ex*Ey]
-    memset(Fn, 0.0, Nx*Ny); // zero out Fn
-    for (int j = 0; j < Ey; j++) {
-      for (int i = 0; i < Ex; i++) {
-	int e = Ex*j+i;
-	Fn[Nx*j+i]       += Re[4*e]   * Xe[e];
-	Fn[Nx*j+i+1]     += Re[4*e+1] * Xe[e];
-	Fn[Nx*(j+1)+i+1] += Re[4*e+2] * Xe[e];
-	Fn[Nx*(j+1)+i]   += Re[4*e+3] * Xe[e];
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+
+    const int bx = (ex+31)/32;                      // tiles per row
+
+    // Note: solid elements carry no value (see Interpolate), so that only
+    // fully-solid tiles need to be skipped
+    memset(Fn, 0, nx*ny*sizeof(float)); // zero out Fn
+    for (int j = 0; j < ey; j++) {
+      for (int t = 0; t < bx; t++) {
+	if (Se[bx*j+t] == ~0u) continue; // skip fully-solid tiles
+	for (int i = 32*t; i < std::min(32*t+32,ex); i++) {
+	  int e = ex*j+i;
+	  Fn[nx*j+i]       += Re[4*e]   * Xe[e];
+	  Fn[nx*j+i+1]     += Re[4*e+1] * Xe[e];
+	  Fn[nx*(j+1)+i+1] += Re[4*e+2] * Xe[e];
+	  Fn[nx*(j+1)+i]   += Re[4*e+3] * Xe[e];
+	}
+      }
+    }
+
+    // Gather the contributions to coincident periodic nodes
+    if (bc[LEFT] == PERIODIC) {
+      for (int j = 0; j < ny; j++) {
+	Fn[nx*j] += Fn[nx*j+(nx-1)];
+	Fn[nx*j+(nx-1)] = Fn[nx*j];
+      }
+    }
+    if (bc[BOTTOM] == PERIODIC) {
+      for (int i = 0; i < nx; i++) {
+	Fn[i] += Fn[nx*(ny-1)+i];
+	Fn[nx*(ny-1)+i] = Fn[i];
       }
     }
   } // Integrate
 
+  template<int EX = 0, int EY = 0>
   void Remap(float* Xn) {
           // Xn[Nx*Ny]
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+
     // Solve M * Xn = Fn through Jacobi relaxation
+    if (lumped) {
+      RemapLumped<EX,EY>(Xn);
+      return;
+    }
 
     // set constant(s)
     const float tol = 1.0e-5;
 
-    // iterate on the residual
-    UpdateResidual(Xn);
-    while (Norm() > tol) {
-      UpdateIncrement();
-      UpdateResidual(dUn);
-      for (int i = 0; i < Nx*Ny; i++) {
-	Xn[i] += dUn[i];
+    // iterate on the residual (dUn holds the field first, then its
+    // increments, padded with their ghost layer)
+    const int Gx = nx + 2; // row stride of dUn
+    Pad(dUn, Xn, nx, ny);
+    UpdateResidual<EX,EY>(dUn);
+    while (Norm<EX,EY>() > tol) {
+      UpdateIncrement<EX,EY>();
+      UpdateResidual<EX,EY>(dUn);
+      for (int j = 0; j < ny; j++) {
+	for (int i = 0; i < nx; i++) {
+	  Xn[nx*j+i] += dUn[Gx*(j+1)+i+1];
+	}
       }
     }
   } // Remap
 
+  template<int EX = 0, int EY = 0>
+  void RemapLumped(float* Xn) {
+                // Xn[Nx*Ny]
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+
+    // Solve ML * Xn = Fn explicitly (ML is the lumped mass matrix), then
+    // apply a fixed number of defect-correction sweeps:
+    // Xn += inv(ML) * (Fn - M * Xn)
+
+    // single explicit pass (dUn is padded with its ghost layer)
+    const int Gx = nx + 2; // row stride of dUn
+    LumpedIncrement<EX,EY>();
+    for (int j = 0; j < ny; j++) {
+      memcpy(Xn + nx*j, dUn + Gx*(j+1) + 1, nx*sizeof(float));
+    }
+
+    // correct the defect of the lumped solution
+    for (int k = 0; k < sweeps; k++) {
+      UpdateResidual<EX,EY>(dUn);
+      LumpedIncrement<EX,EY>();
+      for (int j = 0; j < ny; j++) {
+	for (int i = 0; i < nx; i++) {
+	  Xn[nx*j+i] += dUn[Gx*(j+1)+i+1];
+	}
+      }
+    }
+  } // RemapLumped
+
+  template<int EX = 0, int EY = 0>
   void UpdateResidual(float* Xn) {
-                   // Fn[Nx*Ny], Xn[Nx*Ny]
+                   // Fn[Nx*Ny], Xn[(Nx+2)*(Ny+2)] (padded)
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+    const int Gx = nx + 2;     // row stride of Xn
+    const int bn = (nx+31)/32; // node tiles per row
+
     // Compute Fn -= M * Xn
 
     // set constant(s)
     const float w = dx*dx/36.0;
 
-    // (-1,-1)
-    for (int j = 1; j < Ny; j++) {
-      for (int i = 1; i < Nx; i++) {
-	Fn[Nx*j+i] -= w * Xn[Nx*(j-1)+i-1];
-      }
-    }
-    // (0,-1)
-    for (int j = 1; j < Ny; j++) {
-      for (int i = 0; i < Nx; i++) {
-	Fn[Nx*j+i] -= 4.0 * w * Xn[Nx*(j-1)+i];
+    // M is separable, M = w * (T x T), where T is the mass matrix of linear
+    // elements along a line: rows (1 4 1), and (2 1) on a wall. Ghosts of
+    // -2 times the wall nodes turn (1 4 1) into (2 1), so that the wall rows
+    // of the 9-point stencil hold the two elements (and the corners the one
+    // element) around their nodes, as the lumped masses Wn do, and a
+    // constant field stays constant at the walls; periodic ghosts wrap
+    // around. The stencil is applied on the tiles of nodes with a fluid
+    // element around; it assumes fluid elements all around, so the solid
+    // elements are then taken out of the residual of the cut nodes
+    FillGhosts(Xn, nx, ny, true, -2.0);
+    for (int j = 0; j < ny; j++) {
+      const float* g = Xn + Gx*(j+1) + 1;
+      for (int t = 0; t < bn; t++) {
+	if (Sn[bn*j+t] == ~0u) continue; // skip solid tiles
+	for (int i = 32*t; i < std::min(32*t+32,nx); i++) {
+	  Fn[nx*j+i] -= w * (       g[i-Gx-1] + 4.0 * g[i-Gx] +        g[i-Gx+1]
+                             + 4.0 * g[i-1]    + 16.0 * g[i]   + 4.0 * g[i+1]
+                             +       g[i+Gx-1] + 4.0 * g[i+Gx] +        g[i+Gx+1]);
+	}
+	if (Sn[bn*j+t] | Cn[bn*j+t]) CutResidual(Xn, j, t);
       }
     }
-    // (+1,-1)
-    for (int j = 1; j < Ny; j++) {
-      for (int i = 0; i < (Nx-1); i++) {
-	Fn[Nx*j+i] -= w * Xn[Nx*(j-1)+i+1];
-      }
-    }
-    // (-1,0)
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 1; i < Nx; i++) {
-	Fn[Nx*j+i] -= 4.0 * w * Xn[Nx*j+i-1];
-      }
-    }
-    // (0,0)
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 0; i < Nx; i++) {
-	Fn[Nx*j+i] -= 16.0 * w * Xn[Nx*j+i];
-      }
-    }
-    // (+1,0)
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 0; i < (Nx-1); i++) {
-	Fn[Nx*j+i] -= 4.0 * w * Xn[Nx*j+i+1];
-      }
-    }
-    // (-1,+1)
-    for (int j = 0; j < (Ny-1); j++) {
-      for (int i = 1; i < Nx; i++) {
-	Fn[Nx*j+i] -= w * Xn[Nx*(j+1)+i-1];
-      }
-    }
-    // (0,+1)
-    for (int j = 0; j < (Ny-1); j++) {
-      for (int i = 0; i < Nx; i++) {
-	Fn[Nx*j+i] -= 4.0 * w * Xn[Nx*(j+1)+i];
-      }
+  } // UpdateResidual
+
+  void CutResidual(const float* Xn, int j, int t) {
+                  // Fn[Nx*Ny], Xn[(Nx+2)*(Ny+2)] (padded)
+    // Add back the rows of the (bilinear) element mass matrices of the solid
+    // elements around the cut nodes of tile t of row j, and clear the
+    // residual of its solid nodes (which is zero, from Integrate)
+    const float w = dx*dx/36.0;
+    const bool px = (bc[LEFT] == PERIODIC);
+    const bool py = (bc[BOTTOM] == PERIODIC);
+    const uint32_t valid = (32*t+32 <= Nx) ? ~0u : (1u << (Nx%32)) - 1;
+    for (uint32_t solid = Sn[Bn*j+t] & valid; solid != 0; solid &= solid - 1) {
+      Fn[Nx*j+32*t+__builtin_ctz(solid)] = 0.0;
     }
-    // (+1,+1)
-    for (int j = 0; j < (Ny-1); j++) {
-      for (int i = 0; i < (Nx-1); i++) {
-	Fn[Nx*j+i] -= w * Xn[Nx*(j+1)+i+1];
+    for (uint32_t cut = Cn[Bn*j+t]; cut != 0; cut &= cut - 1) {
+      const int i = 32*t + __builtin_ctz(cut);
+      for (int ly = 0; ly < 2; ly++) {     // node at the bottom (0) or top (1)
+	for (int lx = 0; lx < 2; lx++) {   // and left (0) or right (1) of the element
+	  int a = i - lx, b = j - ly;
+	  if (px) a = (a + Ex) % Ex;
+	  if (py) b = (b + Ey) % Ey;
+	  if ((a < 0) || (a >= Ex) || (b < 0) || (b >= Ey) || !Solid(a, b)) continue;
+	  const int Gx = Nx + 2;
+	  const float* x = Xn + Gx*(b+1) + a+1;
+	  Fn[Nx*j+i] += w * (4.0 * x[Gx*ly+lx]     + 2.0 * x[Gx*ly+(1-lx)]
+	                   + 2.0 * x[Gx*(1-ly)+lx] +       x[Gx*(1-ly)+(1-lx)]);
+	}
       }
     }
-  } // UpdateResidual
+  } // CutResidual
 
+  template<int EX = 0, int EY = 0>
   float Norm(void) {
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+
     // Compute the normalized L2 norm of the residual, where
     // Norm = sqrt(Fn' * M * Fn) / sqrt(Ex*Ey*dx^2)
     // However: use the diagonalized (approximate row-averaged) M, for speed
+    if (solidNodes == 0) {
+      return std::sqrt(SumSquares(Fn, nx*ny)/(ex*ey));
+    }
 
-    float norm = 0.0;
-    for (int i = 0; i < Nx*Ny; i++) {
-      norm += Fn[i] * Fn[i];
+    // with obstacles, sum the rows without their solid tiles (whose
+    // residual is zero), in a fixed order as well
+    const int bn = (nx+31)/32;
+    double sum = 0.0;
+    for (int j = 0; j < ny; j++) {
+      for (int t = 0; t < bn; t++) {
+	if (Sn[bn*j+t] == ~0u) continue; // skip solid tiles
+	int u = t;
+	while ((u+1 < bn) && (Sn[bn*j+u+1] != ~0u)) u++;
+	sum += SumSquares(Fn + nx*j + 32*t, std::min(32*u+32,nx) - 32*t);
+	t = u;
+      }
     }
-    return std::sqrt(norm/(Ex*Ey));
+    return std::sqrt(sum/(ex*ey));
   } // Norm
 
+  static float SumSquares(const float* x, int n) {
+    // Sum the squares of x[0..n) in a fixed order, whatever the compiler or
+    // a split of the work (at block boundaries) between threads: in blocks
+    // of 256, of 8 interleaved lanes each, and the blocks pairwise (which
+    // also bounds the rounding error by the log of the number of blocks)
+    if (n > 256) {
+      int h = (((n+255)/256 + 1) / 2) * 256; // the first half of the blocks
+      return SumSquares(x, h) + SumSquares(x + h, n - h);
+    }
+    float s[8] = {0};
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+      for (int l = 0; l < 8; l++) {
+	s[l] += x[i+l] * x[i+l];
+      }
+    }
+    for (; i < n; i++) {
+      s[i & 7] += x[i] * x[i];
+    }
+    return ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+  } // SumSquares
+
+  template<int EX = 0, int EY = 0>
   void UpdateIncrement(void) {
-    // Compute dUn = P * Fn (P is an approximation to inv(M))
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
 
-    // Use Jacobi relaxation (divide by the diagonal entries of M)
-    
-    // corners
-    float w = 1.0/(4.0*dx*dx);
-    dUn[0]                = w * Fn[0];
-    dUn[Nx-1]             = w * Fn[Nx-1];
-    dUn[Nx*(Ny-1)+(Nx-1)] = w * Fn[Nx*(Ny-1)+(Nx-1)];
-    dUn[Nx*(Ny-1)]        = w * Fn[Nx*(Ny-1)];
+    // Compute dUn = P * Fn (P is an approximation to inv(M))
 
-    // edges
-    w = 1.0/(8.0*dx*dx);
-    for (int i = 1; i < (Nx-1); i++) {
-      dUn[i]           = w * Fn[i];
-      dUn[Nx*(Ny-1)+i] = w * Fn[Nx*(Ny-1)+i];
-    }
-    for (int j = 1; j < (Ny-1); j++) {
-      dUn[Nx*j+(Nx-1)] = w * Fn[Nx*j+(Nx-1)];
-      dUn[Nx*j]        = w * Fn[Nx*j];
+    // Use (damped) Jacobi relaxation: scale the residual by 1/16 of the
+    // inverse lumped mass (no increment on solid nodes), into the interior
+    // of the padded dUn
+    const int Gx = nx + 2;
+    const int bn = (nx+31)/32;
+    for (int j = 0; j < ny; j++) {
+      float* d = dUn + Gx*(j+1) + 1;
+      for (int t = 0; t < bn; t++) {
+	const int i0 = 32*t, i1 = std::min(32*t+32,nx);
+	if (Sn[bn*j+t] == ~0u) { // solid tile: no increment
+	  memset(d+i0, 0, (i1-i0)*sizeof(float));
+	  continue;
+	}
+	for (int i = i0; i < i1; i++) {
+	  d[i] = 0.0625 * Wn[nx*j+i] * Fn[nx*j+i];
+	}
+      }
     }
+  } // UpdateIncrement
 
-    // middle
-    w = 1.0/(16.0*dx*dx);
-    for (int j = 1; j < (Ny-1); j++) {
-      for (int i = 1; i < (Nx-1); i++) {
-	dUn[Nx*j+i] = w * Fn[Nx*j+i];
+  template<int EX = 0, int EY = 0>
+  void LumpedIncrement(void) {
+    const int ex = EX ? EX : Ex, nx = ex + 1;       // compile-time constants
+    const int ey = EY ? EY : Ey, ny = ey + 1;       // for fixed-size meshes
+
+    // Compute dUn = inv(ML) * Fn (ML is the row-summed mass matrix; the
+    // residual of solid nodes is zero), into the interior of the padded dUn
+    const int Gx = nx + 2;
+    const int bn = (nx+31)/32;
+    for (int j = 0; j < ny; j++) {
+      float* d = dUn + Gx*(j+1) + 1;
+      for (int t = 0; t < bn; t++) {
+	const int i0 = 32*t, i1 = std::min(32*t+32,nx);
+	if (Sn[bn*j+t] == ~0u) { // solid tile: no increment
+	  memset(d+i0, 0, (i1-i0)*sizeof(float));
+	  continue;
+	}
+	for (int i = i0; i < i1; i++) {
+	  d[i] = Wn[nx*j+i] * Fn[nx*j+i];
+	}
       }
     }
-  } // UpdateIncrement
-  
+  } // LumpedIncrement
+
 };
 
 #endif // MESH_H
@@ -0,0 +1,616 @@
+#ifndef MESH3D_H
+#define MESH3D_H
+
+// include standard C/C++ libraries
+#include <cstring>   // memcpy, strlen, strcmp
+#include <vector>    // vector
+#include <thread>    // hardware_concurrency
+#include <algorithm> // min, max
+
+// include project headers
+#include "field.h"     // Field::SaveNpy, Field::SavePpm
+#include "denormals.h" // FlushDenormals
+#include "pool.h"      // Pool
+
+// The hexahedral counterpart of Mesh: Ex x Ey x Ez cubic elements of side
+// dx, with trilinear nodal velocities and a piecewise-constant pressure
+// head (or dye), advanced by the same remap (with the 8-node integral
+// operator of every element) and momentum update (7-point viscous stencil,
+// and the pressure head gradient).
+//
+// Nodes and elements are stored x fastest, then y, then z. Each axis is
+// either periodic (the last plane of nodes coincides with the first), or
+// closed by no-slip walls, the top wall (z = Ez) sliding along x at the lid
+// speed.
+//
+// The consistent mass matrix of trilinear elements is the tensor product of
+// the 1D mass matrices dx/6 (1 4 1) (2 1 at walls, cyclic across periodic
+// sides), so that it is solved exactly by tridiagonal line solves along x,
+// y and z in turn, with one factorization per axis shared by every line;
+// the lumped mass is its row sum.
+//
+// The kernels run over z-slabs of the mesh (y-slabs for the z-line solve),
+// one per thread, and walk each slab plane by plane, row by row, so that the
+// working set of a kernel is a few planes of each array; the integral
+// operator is stored corner by corner, so that every inner loop runs over
+// contiguous rows.
+//
+// Memory footprint, per million elements (and as many nodes): 12 MB for
+// the velocities, 4 MB for the pressure head, 32 MB for the integral
+// operator, and 16 MB for the inverse lumped mass and the workspaces, i.e.
+// 64 MB (Bytes() reports the exact figure).
+class Mesh3D {
+public:
+
+  // Axes
+  enum Axis { X, Y, Z };
+
+  // Discretization parameters
+  int Nx, Ny, Nz; // Number of nodes in the x-, y- and z-directions
+  int Ex, Ey, Ez; // Number of elements in the x-, y- and z-directions
+  float dx;       // Grid spacing
+  float dt;       // Time step
+  bool lumped;    // Remap with the lumped (row-summed) mass matrix
+  float viscosity; // Kinematic viscosity
+  float lid;      // Speed of the top wall (along x)
+  bool periodic[3]; // Periodic axes (X, Y, Z)
+  int threads;    // Number of threads (z-slabs)
+
+  // Field variables
+  float* Vxn; // Nodal x-velocity      [Nx*Ny*Nz]
+  float* Vyn; // Nodal y-velocity      [Nx*Ny*Nz]
+  float* Vzn; // Nodal z-velocity      [Nx*Ny*Nz]
+  float* He;  // Element pressure head [Ex*Ey*Ez]
+
+  // Transfer operators
+  float* Re;  // Remap integral operator, corner by corner [8*Ex*Ey*Ez]
+  float* Wn;  // Inverse lumped mass [Nx*Ny*Nz]
+
+  // Workspace arrays
+  float* Un;  // Nodal field    [Nx*Ny*Nz]
+  float* Fn;  // Nodal integral [Nx*Ny*Nz]
+  float* Ue;  // Element field  [Ex*Ey*Ez]
+
+  Pool* pool; // Threads of the slabs, or NULL (started with the first kernel)
+
+  Mesh3D(int ex, int ey, int ez, float width) {
+    Ex = ex;
+    Ey = ey;
+    Ez = ez;
+    Nx = Ex + 1;
+    Ny = Ey + 1;
+    Nz = Ez + 1;
+    dx = width;
+    dt = 1.0;          // default initialization
+    lumped = false;    // default initialization
+    viscosity = 0.01;  // default initialization
+    lid = 5.0;         // default initialization: lid-driven cavity
+    periodic[X] = periodic[Y] = periodic[Z] = false;
+    threads = std::max(1u, std::thread::hardware_concurrency());
+    const long N = long(Nx)*Ny*Nz, E = long(Ex)*Ey*Ez;
+    Vxn = new float[N](); // zero initialization
+    Vyn = new float[N](); // zero initialization
+    Vzn = new float[N](); // zero initialization
+    He  = new float[E](); // zero initialization
+    Re  = new float[8*E];
+    Wn  = new float[N];
+    Un  = new float[N];
+    Fn  = new float[N];
+    Ue  = new float[E];
+    pool = NULL;
+    UpdateMass();
+  } // Mesh3D
+
+  ~Mesh3D() {
+    delete[] Vxn;
+    delete[] Vyn;
+    delete[] Vzn;
+    delete[] He;
+    delete[] Re;
+    delete[] Wn;
+    delete[] Un;
+    delete[] Fn;
+    delete[] Ue;
+    delete pool;
+  } // ~Mesh3D
+
+  // The arrays (and the pool) are owned: no copies
+  Mesh3D(const Mesh3D&) = delete;
+  Mesh3D& operator=(const Mesh3D&) = delete;
+
+  long Bytes(void) {
+    // Memory footprint of the arrays
+    const long N = long(Nx)*Ny*Nz, E = long(Ex)*Ey*Ez;
+    return sizeof(float) * (6*N + 10*E);
+  } // Bytes
+
+  void SetPeriodic(int axis, bool p) {
+    periodic[axis] = p;
+    UpdateMass();
+  } // SetPeriodic
+
+  void Update(float new_dt) {
+    // Update the time step
+    dt = new_dt;
+
+    // The consistent mass spreads the lid velocity in tails that decay
+    // geometrically into denormals, which cost ~100 cycles each: flush
+    // them (the threads of the slabs take the control register)
+    FlushDenormals flush;
+
+    // Form the integral operator
+    UpdateIntegralOperator();
+
+    // Update velocity field
+    UpdateNodalField(Vxn);
+    UpdateNodalField(Vyn);
+    UpdateNodalField(Vzn);
+    UpdateMomentum();
+
+    // Update pressure head field
+    UpdateElementField(He);
+
+    // Enforce BCs
+    EnforceNodalBCs();
+  } // Update
+
+  void UpdateNodalField(float* Xn) {
+                     // Xn[Nx*Ny*Nz]
+    Interpolate(Xn, Ue);
+    Integrate(Ue); Remap(Xn);
+  } // UpdateNodalField
+
+  void UpdateElementField(float* Xe) {
+                       // Xe[Ex*Ey*Ez]
+    Integrate(Xe); Remap(Un);
+    Interpolate(Un, Xe);
+  } // UpdateElementField
+
+  void UpdateIntegralOperator(void) {
+    // Weights of the 8 nodes of every element, at its center moved by the
+    // mean velocity of the element over dt, times its volume dilated by the
+    // divergence over dt (cf. Mesh::UpdateIntegralOperator)
+    const long E = long(Ex)*Ey*Ez;
+    const int P = Nx*Ny;
+    const float scale = 0.25*dt/dx;
+    const float h3 = 0.125*dx*dx*dx;
+    Slabs(Ez, [=](int k0, int k1) {
+      for (int k = k0; k < k1; k++) {
+	for (int j = 0; j < Ey; j++) {
+	  const int e = Ex*(Ey*k+j), n = Nx*(Ny*k+j);
+	  const float* u = Vxn + n;
+	  const float* v = Vyn + n;
+	  const float* w = Vzn + n;
+	  for (int i = 0; i < Ex; i++) {
+	    // corners c = cx + 2 cy + 4 cz, at offsets i + cx + Nx cy + P cz
+	    float u0 = u[i], u1 = u[i+1], u2 = u[i+Nx], u3 = u[i+Nx+1];
+	    float u4 = u[i+P], u5 = u[i+P+1], u6 = u[i+P+Nx], u7 = u[i+P+Nx+1];
+	    float v0 = v[i], v1 = v[i+1], v2 = v[i+Nx], v3 = v[i+Nx+1];
+	    float v4 = v[i+P], v5 = v[i+P+1], v6 = v[i+P+Nx], v7 = v[i+P+Nx+1];
+	    float w0 = w[i], w1 = w[i+1], w2 = w[i+Nx], w3 = w[i+Nx+1];
+	    float w4 = w[i+P], w5 = w[i+P+1], w6 = w[i+P+Nx], w7 = w[i+P+Nx+1];
+	    float div = (u1+u3+u5+u7 - u0-u2-u4-u6)
+	              + (v2+v3+v6+v7 - v0-v1-v4-v5)
+	              + (w4+w5+w6+w7 - w0-w1-w2-w3);
+	    float vol = h3 * (1.0f + scale*div);
+	    float xi   = scale*(u0+u1+u2+u3+u4+u5+u6+u7);
+	    float eta  = scale*(v0+v1+v2+v3+v4+v5+v6+v7);
+	    float zeta = scale*(w0+w1+w2+w3+w4+w5+w6+w7);
+	    float xm = 1.0f-xi, xp = 1.0f+xi;
+	    float ym = vol*(1.0f-eta), yp = vol*(1.0f+eta);
+	    float zm = 1.0f-zeta, zp = 1.0f+zeta;
+	    Re[0*E+e+i] = xm*ym*zm;
+	    Re[1*E+e+i] = xp*ym*zm;
+	    Re[2*E+e+i] = xm*yp*zm;
+	    Re[3*E+e+i] = xp*yp*zm;
+	    Re[4*E+e+i] = xm*ym*zp;
+	    Re[5*E+e+i] = xp*ym*zp;
+	    Re[6*E+e+i] = xm*yp*zp;
+	    Re[7*E+e+i] = xp*yp*zp;
+	  }
+	}
+      }
+    });
+  } // UpdateIntegralOperator
+
+  void Interpolate(const float* Xn, float* Xe) {
+                // Xn[Nx*Ny*Nz], Xe[Ex*Ey*Ez]
+    // Average the 8 nodes of every element
+    const int P = Nx*Ny;
+    Slabs(Ez, [=](int k0, int k1) {
+      for (int k = k0; k < k1; k++) {
+	for (int j = 0; j < Ey; j++) {
+	  const float* x = Xn + Nx*(Ny*k+j);
+	  float* y = Xe + Ex*(Ey*k+j);
+	  for (int i = 0; i < Ex; i++) {
+	    y[i] = 0.125f*(x[i]   + x[i+1]   + x[i+Nx]   + x[i+Nx+1]
+	                  +x[i+P] + x[i+P+1] + x[i+P+Nx] + x[i+P+Nx+1]);
+	  }
+	}
+      }
+    });
+  } // Interpolate
+
+  void Integrate(const float* Xe) {
+              // Xe[Ex*Ey*Ez]
+    // Gather into every node (of Fn) the weighted values of the (up to 8)
+    // elements around it, so that the slabs write disjoint nodes
+    const long E = long(Ex)*Ey*Ez;
+    Slabs(Nz, [=](int k0, int k1) {
+      for (int k = k0; k < k1; k++) {
+	for (int j = 0; j < Ny; j++) {
+	  float* f = Fn + Nx*(Ny*k+j);
+	  std::fill(f, f + Nx, 0.0f);
+	  for (int cz = 0; cz < 2; cz++) {
+	    int ke = k - cz;
+	    if ((ke < 0) || (ke >= Ez)) continue;
+	    for (int cy = 0; cy < 2; cy++) {
+	      int je = j - cy;
+	      if ((je < 0) || (je >= Ey)) continue;
+	      // the element to the right of the node (corner cx = 0), and to
+	      // its left (corner cx = 1)
+	      const long e = Ex*(Ey*long(ke)+je);
+	      const float* r0 = Re + (2*cy+4*cz)*E + e;
+	      const float* r1 = Re + (1+2*cy+4*cz)*E + e;
+	      const float* x = Xe + e;
+	      f[0] += r0[0]*x[0];
+	      for (int i = 1; i < Ex; i++) {
+		f[i] += r0[i]*x[i] + r1[i-1]*x[i-1];
+	      }
+	      f[Ex] += r1[Ex-1]*x[Ex-1];
+	    }
+	  }
+	}
+      }
+    });
+
+    // Gather the contributions to coincident periodic nodes
+    Coincide(Fn, true);
+  } // Integrate
+
+  void Remap(float* Xn) {
+          // Xn[Nx*Ny*Nz]
+    // Solve M * Xn = Fn, with the lumped mass matrix, or exactly with the
+    // consistent one (as line solves along each axis)
+    const long N = long(Nx)*Ny*Nz;
+    if (lumped) {
+      Slabs(Nz, [=](int k0, int k1) {
+	for (long n = long(Nx)*Ny*k0; n < long(Nx)*Ny*k1; n++) {
+	  Xn[n] = Wn[n] * Fn[n];
+	}
+      });
+      return;
+    }
+    const float s = 1.0 / (dx*dx*dx);
+    for (long n = 0; n < N; n++) {
+      Xn[n] = s * Fn[n];
+    }
+    const int P = Nx*Ny;
+    Slabs(Nz, [=](int k0, int k1) {
+      std::vector<float> t(Nx);
+      for (int k = k0; k < k1; k++) {
+	for (int j = 0; j < Ny; j++) {
+	  SolveLines(line[X], Xn + long(P)*k + Nx*j, 1, 1, t.data());
+	}
+	SolveLines(line[Y], Xn + long(P)*k, Nx, Nx, t.data());
+      }
+    });
+    Slabs(Ny, [=](int j0, int j1) {
+      std::vector<float> t(Nx);
+      for (int j = j0; j < j1; j++) {
+	SolveLines(line[Z], Xn + Nx*j, P, Nx, t.data());
+      }
+    });
+  } // Remap
+
+  void UpdateMomentum(void) {
+    // Update the momentum equation: viscous diffusion (7-point stencil),
+    // and the forces due to the pressure head gradient (averaged over the
+    // four element edges along each axis through the node)
+    const float flux = viscosity * dt / (dx*dx);
+    const float force = - dt / dx;
+    Momentum<X>(Vxn, flux, force);
+    Momentum<Y>(Vyn, flux, force);
+    Momentum<Z>(Vzn, flux, force);
+  } // UpdateMomentum
+
+  void EnforceNodalBCs(void) {
+    // Walls: no-slip (the top wall sliding along x); periodic axes: the
+    // last plane of nodes copies the first
+    const int P = Nx*Ny;
+    float* V[3] = { Vxn, Vyn, Vzn };
+    for (int c = 0; c < 3; c++) {
+      float* v = V[c];
+      for (int k = 0; k < Nz; k++) {
+	for (int j = 0; j < Ny; j++) {
+	  float* r = v + long(P)*k + Nx*j;
+	  bool wall = (!periodic[Y] && ((j == 0) || (j == Ey)))
+	           || (!periodic[Z] && ((k == 0) || (k == Ez)));
+	  if (wall) {
+	    float s = (!periodic[Z] && (k == Ez) && (c == X)) ? lid : 0.0f;
+	    if (!periodic[Y] && ((j == 0) || (j == Ey))) s = 0.0f;
+	    std::fill(r, r + Nx, s);
+	  } else if (!periodic[X]) {
+	    r[0] = 0.0f;
+	    r[Ex] = 0.0f;
+	  }
+	}
+      }
+      Coincide(v, false);
+    }
+  } // EnforceNodalBCs
+
+  void Slice(int axis, int index, float* out) {
+    // Copy the plane of elements at an index along an axis, as a row-major
+    // image of the two other axes (x then y, x then z, or y then z)
+    for (int b = 0; b < ((axis == Z) ? Ey : Ez); b++) {
+      for (int a = 0; a < ((axis == X) ? Ey : Ex); a++) {
+	int i = (axis == X) ? index : a;
+	int j = (axis == X) ? a : (axis == Y) ? index : b;
+	int k = (axis == Z) ? index : b;
+	int w = (axis == X) ? Ey : Ex;
+	out[w*b+a] = He[Ex*(Ey*long(k)+j)+i];
+      }
+    }
+  } // Slice
+
+  bool SaveSlice(const char* filename, int axis, int index) {
+    // Write a plane of elements (see Slice) as an NPY file (.npy), or as a
+    // gray-scale PPM image (values from 0 to 1, top row first)
+    int w = (axis == X) ? Ey : Ex;
+    int h = (axis == Z) ? Ey : Ez;
+    std::vector<float> plane(w*h);
+    Slice(axis, index, plane.data());
+    size_t length = strlen(filename);
+    if ((length > 4) && (strcmp(filename + length - 4, ".npy") == 0)) {
+      return Field::SaveNpy(filename, plane.data(), w, h);
+    }
+    std::vector<unsigned char> image(3*w*h);
+    for (int r = 0; r < h; r++) {
+      for (int s = 0; s < w; s++) {
+	float c = std::min(std::max(plane[w*(h-1-r)+s], 0.0f), 1.0f);
+	image[3*(w*r+s)] = image[3*(w*r+s)+1] = image[3*(w*r+s)+2]
+	                 = (unsigned char)(255.0 * c + 0.5);
+      }
+    }
+    return Field::SavePpm(filename, image.data(), w, h);
+  } // SaveSlice
+
+private:
+
+  // Factorization of the 1D mass matrix (1 4 1)/6 along an axis, over its n
+  // distinct nodes: modified super-diagonal cp, inverse pivots m, and (for
+  // the cyclic matrix of a periodic axis) the Sherman-Morrison correction z
+  // and its scale q
+  struct Line {
+    int n;
+    bool cyclic;
+    std::vector<float> cp, m, z;
+    float q;
+  };
+  Line line[3];
+
+  template<class Kernel>
+  void Slabs(int n, Kernel kernel) {
+    // Run kernel(p0, p1) over n planes, split into contiguous slabs, one
+    // per thread of the pool (started once, and again only when the number
+    // of threads is changed)
+    int T = std::max(1, std::min(threads, n / 4));
+    if (T == 1) {
+      kernel(0, n);
+      return;
+    }
+    if ((pool == NULL) || (pool->Size() != threads)) {
+      delete pool;
+      pool = new Pool(threads);
+    }
+    pool->Run(T, [&](int t) { kernel((n*t)/T, (n*(t+1))/T); });
+  } // Slabs
+
+  void UpdateMass(void) {
+    // Inverse lumped mass (half the mass per wall, cf. Mesh), and the
+    // factorizations of the consistent mass along every axis
+    int n[3] = { Nx, Ny, Nz };
+    for (int a = 0; a < 3; a++) {
+      Factor(line[a], periodic[a] ? n[a]-1 : n[a], periodic[a]);
+    }
+    for (int k = 0; k < Nz; k++) {
+      float mz = (!periodic[Z] && ((k == 0) || (k == Ez))) ? 0.5 : 1.0;
+      for (int j = 0; j < Ny; j++) {
+	float my = (!periodic[Y] && ((j == 0) || (j == Ey))) ? 0.5 : 1.0;
+	for (int i = 0; i < Nx; i++) {
+	  float mx = (!periodic[X] && ((i == 0) || (i == Ex))) ? 0.5 : 1.0;
+	  Wn[Nx*(Ny*long(k)+j)+i] = 1.0/(mx*my*mz*dx*dx*dx);
+	}
+      }
+    }
+  } // UpdateMass
+
+  static void Factor(Line& L, int n, bool cyclic) {
+    // Thomas factorization of (1 4 1)/6, with (2 1)/6 at the ends of an
+    // open line; a cyclic line is factored as the tridiagonal matrix with
+    // modified corners (gamma = -b), plus a rank-one correction
+    const float a = 1.0/6.0, b = 4.0/6.0, c = 1.0/6.0;
+    const float gamma = -b;
+    L.n = n;
+    L.cyclic = cyclic;
+    L.cp.assign(n, 0.0);
+    L.m.assign(n, 0.0);
+    std::vector<float> d(n, b);
+    if (cyclic) {
+      d[0] = b - gamma;
+      d[n-1] = b - a*c/gamma;
+    } else {
+      d[0] = d[n-1] = 2.0/6.0;
+    }
+    L.m[0] = 1.0 / d[0];
+    L.cp[0] = c * L.m[0];
+    for (int t = 1; t < n; t++) {
+      L.m[t] = 1.0 / (d[t] - a*L.cp[t-1]);
+      L.cp[t] = c * L.m[t];
+    }
+    if (cyclic) {
+      // z solves the modified system for u = (gamma, 0, ..., 0, c)
+      L.z.assign(n, 0.0);
+      L.z[0] = gamma;
+      L.z[n-1] = c;
+      float* z = L.z.data();
+      Solve(L, z, 1, 1, NULL);
+      L.q = 1.0 / (1.0 + z[0] + a*z[n-1]/gamma);
+    }
+  } // Factor
+
+  static void Solve(const Line& L, float* x, int stride, int count, float* t) {
+    // Forward and backward substitutions of count adjacent lines (x[l],
+    // x[stride+l], ...), with the factorization L; then, for a cyclic line
+    // (unless solving for z itself, with t = NULL), the rank-one correction
+    // (t holds a coefficient per line)
+    const float a = 1.0/6.0, gamma = -4.0/6.0;
+    const int n = L.n;
+    for (int l = 0; l < count; l++) {
+      x[l] *= L.m[0];
+    }
+    for (int s = 1; s < n; s++) {
+      float* r = x + long(stride)*s;
+      const float* p = r - stride;
+      const float m = L.m[s];
+      for (int l = 0; l < count; l++) {
+	r[l] = (r[l] - a*p[l]) * m;
+      }
+    }
+    for (int s = n-2; s >= 0; s--) {
+      float* r = x + long(stride)*s;
+      const float* p = r + stride;
+      const float cp = L.cp[s];
+      for (int l = 0; l < count; l++) {
+	r[l] -= cp * p[l];
+      }
+    }
+    if (!L.cyclic || (t == NULL)) return;
+    const float* last = x + long(stride)*(n-1);
+    for (int l = 0; l < count; l++) {
+      t[l] = (x[l] + a*last[l]/gamma) * L.q;
+    }
+    for (int s = 0; s < n; s++) {
+      float* r = x + long(stride)*s;
+      const float z = L.z[s];
+      for (int l = 0; l < count; l++) {
+	r[l] -= t[l] * z;
+      }
+    }
+  } // Solve
+
+  static void SolveLines(const Line& L, float* x, int stride, int count, float* t) {
+    // Solve count adjacent lines, and copy the first node of a cyclic line
+    // to its coincident last node
+    Solve(L, x, stride, count, t);
+    if (L.cyclic) {
+      memcpy(x + long(stride)*L.n, x, count*sizeof(float));
+    }
+  } // SolveLines
+
+  void Coincide(float* Xn, bool gather) {
+    // For every periodic axis, sum the two coincident planes of nodes into
+    // both (gather), or copy the first into the last
+    const int P = Nx*Ny;
+    if (periodic[X]) {
+      for (long r = 0; r < long(Ny)*Nz; r++) {
+	float* x = Xn + Nx*r;
+	if (gather) x[0] += x[Ex];
+	x[Ex] = x[0];
+      }
+    }
+    if (periodic[Y]) {
+      for (int k = 0; k < Nz; k++) {
+	float* x0 = Xn + long(P)*k;
+	float* x1 = x0 + Nx*Ey;
+	for (int i = 0; i < Nx; i++) {
+	  if (gather) x0[i] += x1[i];
+	  x1[i] = x0[i];
+	}
+      }
+    }
+    if (periodic[Z]) {
+      float* x0 = Xn;
+      float* x1 = Xn + long(P)*Ez;
+      for (int n = 0; n < P; n++) {
+	if (gather) x0[n] += x1[n];
+	x1[n] = x0[n];
+      }
+    }
+  } // Coincide
+
+  int Neighbor(int i, int d, int n, bool p) {
+    // Node i+d (d = -1 or +1) of an axis of n nodes: wrapped across a
+    // periodic axis (whose last node is the first), clamped otherwise
+    if (p) {
+      if (i + d < 0) return n-2;
+      if (i + d > n-1) return 1;
+      return i + d;
+    }
+    return std::min(std::max(i + d, 0), n-1);
+  } // Neighbor
+
+  int Element(int i, int d, int e, bool p) {
+    // Element on side d (-1: before, 0: after) of node i, along an axis of
+    // e elements: wrapped across a periodic axis, clamped (mirrored) at walls
+    int k = i + d;
+    if (p) return (k + e) % e;
+    return std::min(std::max(k, 0), e-1);
+  } // Element
+
+  template<int AXIS>
+  void Momentum(float* V, float flux, float force) {
+    // Add the viscous diffusion and the pressure head gradient (along an
+    // axis) to a velocity component (the node values at walls are reset by
+    // the BCs)
+    const int P = Nx*Ny;
+    const long N = long(P)*Nz;
+    memcpy(Un, V, N*sizeof(float));
+    Slabs(Nz, [=](int k0, int k1) {
+      for (int k = k0; k < k1; k++) {
+	int kp = Neighbor(k, -1, Nz, periodic[Z]), kn = Neighbor(k, +1, Nz, periodic[Z]);
+	int ka = Element(k, -1, Ez, periodic[Z]),  kb = Element(k, 0, Ez, periodic[Z]);
+	for (int j = 0; j < Ny; j++) {
+	  int jp = Neighbor(j, -1, Ny, periodic[Y]), jn = Neighbor(j, +1, Ny, periodic[Y]);
+	  int ja = Element(j, -1, Ey, periodic[Y]),  jb = Element(j, 0, Ey, periodic[Y]);
+	  const float* u  = Un + long(P)*k + Nx*j;
+	  const float* us = Un + long(P)*k + Nx*jp;
+	  const float* un = Un + long(P)*k + Nx*jn;
+	  const float* ub = Un + long(P)*kp + Nx*j;
+	  const float* ut = Un + long(P)*kn + Nx*j;
+	  // the four element rows around the node row
+	  const float* h00 = He + Ex*(Ey*long(ka)+ja);
+	  const float* h01 = He + Ex*(Ey*long(ka)+jb);
+	  const float* h10 = He + Ex*(Ey*long(kb)+ja);
+	  const float* h11 = He + Ex*(Ey*long(kb)+jb);
+	  float* v = V + long(P)*k + Nx*j;
+	  // node i, between nodes ip and in, and elements ia and ib
+	  auto node = [&](int i, int ip, int in, int ia, int ib) {
+	    float lap = u[ip] + u[in] + us[i] + un[i] + ub[i] + ut[i] - 6.0f*u[i];
+	    float grad;
+	    if (AXIS == X) {
+	      grad = (h00[ib] + h01[ib] + h10[ib] + h11[ib])
+	           - (h00[ia] + h01[ia] + h10[ia] + h11[ia]);
+	    } else if (AXIS == Y) {
+	      grad = (h01[ia] + h01[ib] + h11[ia] + h11[ib])
+	           - (h00[ia] + h00[ib] + h10[ia] + h10[ib]);
+	    } else {
+	      grad = (h10[ia] + h10[ib] + h11[ia] + h11[ib])
+	           - (h00[ia] + h00[ib] + h01[ia] + h01[ib]);
+	    }
+	    v[i] += flux * lap + 0.25f * force * grad;
+	  };
+	  node(0, Neighbor(0, -1, Nx, periodic[X]), 1, Element(0, -1, Ex, periodic[X]), 0);
+	  for (int i = 1; i < Ex; i++) {
+	    node(i, i-1, i+1, i-1, i);
+	  }
+	  node(Ex, Ex-1, Neighbor(Ex, +1, Nx, periodic[X]), Ex-1, Element(Ex, 0, Ex, periodic[X]));
+	}
+      }
+    });
+  } // Momentum
+
+};
+
+#endif // MESH3D_H
@@ -0,0 +1,57 @@
+// Measure the cost of a step of the hexahedral mesh (a lid-driven cube,
+// carrying a cube of dye), per size, remap (lumped or consistent mass) and
+// number of threads, with its memory footprint; the middle slices of the
+// dye of the largest mesh are written as images (mesh3d_xy.ppm,
+// mesh3d_xz.ppm) and as an NPY file (mesh3d_xz.npy).
+//
+// usage: ./mesh3d_benchmark [max_size] [steps]
+
+// include project headers
+#include "mesh3d.h" // Mesh3D
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi
+#include<chrono>    // steady_clock
+#include<thread>    // hardware_concurrency
+
+int main(int argc, char** argv) {
+  int max_size = (argc > 1) ? std::atoi(argv[1]) : 128;
+  int steps    = (argc > 2) ? std::atoi(argv[2]) : 10;
+  int cores = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "# size   mass         threads   ms/step    ns/element/step   MB      MB/Melement"
+            << std::endl;
+  for (int n = 32; n <= max_size; n *= 2) {
+    for (int lumped = 1; lumped >= 0; lumped--) {
+      for (int threads = 1; threads <= cores; threads *= 2) {
+	Mesh3D mesh(n, n, n, 1.0);
+	mesh.lumped = lumped;
+	mesh.threads = threads;
+	for (int k = n/4; k < n/2; k++) {
+	  for (int j = n/4; j < 3*n/4; j++) {
+	    for (int i = n/4; i < n/2; i++) {
+	      mesh.He[n*(n*k+j)+i] = 1.0;
+	    }
+	  }
+	}
+	mesh.Update(0.05); // warm up
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int s = 0; s < steps; s++) {
+	  mesh.Update(0.05);
+	}
+	std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double,std::milli>(stop - start).count() / steps;
+	double E = double(n)*n*n;
+	std::cout << n << "      " << (lumped ? "lumped    " : "consistent") << "   " << threads
+	          << "         " << ms << "    " << 1.0e6 * ms / E << "           "
+	          << mesh.Bytes() / 1.0e6 << "   " << mesh.Bytes() / E << std::endl;
+	if ((2*n > max_size) && !lumped && (threads == 1)) {
+	  mesh.SaveSlice("mesh3d_xy.ppm", Mesh3D::Z, 3*n/8);
+	  mesh.SaveSlice("mesh3d_xz.ppm", Mesh3D::Y, n/2);
+	  mesh.SaveSlice("mesh3d_xz.npy", Mesh3D::Y, n/2);
+	}
+      }
+    }
+  }
+  return 0;
+}
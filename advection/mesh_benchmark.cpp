@@ -0,0 +1,65 @@
+// Compare the run time of the fixed-size (compile-time dimensions) meshes
+// against the run-time dimensioned mesh, for the standard grid sizes.
+//
+// usage: ./mesh_benchmark [steps] [sweeps]
+//  -sweeps < 0 selects the consistent-mass remap, otherwise the lumped-mass
+//   remap with the given number of correction sweeps is used
+
+// include project headers
+#include "mesh.h"       // Mesh
+#include "fixed_mesh.h" // FixedMesh, NewMesh
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi
+#include<cmath>     // exp, abs
+#include<chrono>    // steady_clock
+
+// initialize a mesh with a Gaussian bump of pressure head
+void initialize(Mesh* mesh, int sweeps) {
+  mesh->lumped = (sweeps >= 0);
+  mesh->sweeps = std::max(sweeps,0);
+  for (int j = 0; j < mesh->Ey; j++) {
+    for (int i = 0; i < mesh->Ex; i++) {
+      float x = (i + 0.5) / mesh->Ex - 0.5;
+      float y = (j + 0.5) / mesh->Ey - 0.5;
+      mesh->He[mesh->Ex*j+i] = std::exp(-50.0*(x*x+y*y));
+    }
+  }
+}
+
+// advance a mesh by a number of steps, returning the time per step (in ms)
+double run(Mesh* mesh, int steps, float dt) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int n = 0; n < steps; n++) {
+    mesh->UpdateFields(dt);
+  }
+  std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double,std::milli>(stop - start).count() / steps;
+}
+
+int main(int argc, char** argv) {
+  int steps  = (argc > 1) ? std::atoi(argv[1]) : 20;
+  int sweeps = (argc > 2) ? std::atoi(argv[2]) : 4;
+  float dt = 0.02;
+
+  std::cout << "# size        dynamic (ms/step)   fixed (ms/step)   speedup   max |diff|" << std::endl;
+  for (int n = 256; n <= 1024; n *= 2) {
+    Mesh* dynamic = new Mesh(n, n, 1.0);
+    Mesh* fixed = NewMesh(n, n, 1.0);
+    initialize(dynamic, sweeps);
+    initialize(fixed, sweeps);
+    double t0 = run(dynamic, steps, dt);
+    double t1 = run(fixed, steps, dt);
+    float diff = 0.0;
+    for (int i = 0; i < n*n; i++) {
+      diff = std::max(diff, std::abs(dynamic->He[i] - fixed->He[i]));
+    }
+    std::cout << n << "x" << n << "     " << t0 << "             " << t1
+              << "           " << t0/t1 << "     " << diff << std::endl;
+    delete dynamic;
+    delete fixed;
+  }
+
+  return 0;
+}
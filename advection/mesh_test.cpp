@@ -0,0 +1,130 @@
+// Regression checks of the mesh kernels (and of the statistics of their
+// fields): each check prints ok or FAILED, and the exit status is the
+// number of failed checks.
+//
+// usage: ./mesh_test
+
+// include project headers
+#include "mesh.h"        // Mesh
+#include "diagnostics.h" // Diagnostics
+
+// include standard C/C++ libraries
+#include<cstdio>    // printf, snprintf
+#include<cmath>     // abs
+#include<algorithm> // max
+#include<vector>    // vector
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+  printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+  failures += ok ? 0 : 1;
+}
+
+// Clearing a solid element of a padded, fully-solid last tile must clear the
+// padding bits too: the kernels that zero the solid elements of a partially
+// solid tile would otherwise write past the end of the row (and, on the last
+// row, past the end of the field)
+void clearAfterPadding(void) {
+  Mesh mesh(40, 4, 1.0);
+  const int Ex = mesh.Ex, Ey = mesh.Ey;
+  for (int i = 32; i < Ex; i++) {
+    mesh.SetSolid(i, Ey-1, true);
+  }
+  mesh.PadSolids();
+  mesh.SetSolid(33, Ey-1, false);
+
+  bool solids = !mesh.Solid(33, Ey-1);
+  for (int i = 32; i < Ex; i++) {
+    solids = solids && (mesh.Solid(i, Ey-1) == (i != 33));
+  }
+  check(solids, "padded tile: solids after clearing one");
+
+  const float guard = 7.0;
+  std::vector<float> Xe(Ex*Ey + 32, guard);
+  mesh.ClearSolids(&Xe[0]);
+  bool inside = true;
+  for (size_t k = Ex*Ey; k < Xe.size(); k++) {
+    inside = inside && (Xe[k] == guard);
+  }
+  check(inside && (Xe[Ex*(Ey-1)+32] == 0.0) && (Xe[Ex*(Ey-1)+33] == guard),
+        "padded tile: ClearSolids stays within the field");
+
+  std::vector<float> Xn(mesh.Nx*mesh.Ny, 1.0);
+  Xe.assign(Ex*Ey + 32, guard);
+  mesh.Interpolate(&Xn[0], &Xe[0]);
+  inside = true;
+  for (size_t k = Ex*Ey; k < Xe.size(); k++) {
+    inside = inside && (Xe[k] == guard);
+  }
+  check(inside && (Xe[Ex*(Ey-1)+32] == 0.0) && (Xe[Ex*(Ey-1)+33] == 1.0),
+        "padded tile: Interpolate stays within the field");
+
+  mesh.SetSolid(33, Ey-1, true);
+  mesh.Interpolate(&Xn[0], &Xe[0]);
+  inside = true;
+  for (int i = 32; i < Ex; i++) {
+    inside = inside && (Xe[Ex*(Ey-1)+i] == 0.0);
+  }
+  check(inside && (Xe[Ex*Ey] == guard), "padded tile: refilled tile is solid again");
+} // clearAfterPadding
+
+// A constant pressure head at rest must stay constant, at the walls as well
+// as inside: the defect-correction sweeps of the lumped remap (and the
+// consistent remap) solve with the consistent mass matrix, whose wall rows
+// must match the lumped masses
+void constantAtWalls(void) {
+  const int n = 32;
+  for (int sweeps = 0; sweeps <= 3; sweeps++) {
+    for (int lumped = 1; lumped >= 0; lumped--) {
+      if (!lumped && sweeps) continue; // sweeps only apply to the lumped remap
+      Mesh mesh(n, n, 1.0);
+      mesh.lumped = lumped;
+      mesh.sweeps = sweeps;
+      for (int e = 0; e < n*n; e++) {
+	mesh.He[e] = 1.0;
+      }
+      mesh.UpdateIntegralOperator();
+      mesh.UpdateElementField(mesh.He);
+      float error = 0.0;
+      for (int e = 0; e < n*n; e++) {
+	error = std::max(error, std::abs(mesh.He[e] - 1.0f));
+      }
+      char what[64];
+      snprintf(what, sizeof(what), "constant head: %s remap, %d sweeps (error %.1e)",
+	       lumped ? "lumped" : "consistent", sweeps, error);
+      check(error < (lumped ? 1.0e-6 : 1.0e-4), what); // the consistent remap
+                                                       // iterates to 1e-5
+    }
+  }
+} // constantAtWalls
+
+// A uniform flow carries the same kinetic energy (1/2 |v|^2 per unit area)
+// on a periodic mesh as on a closed one: the last column and row of nodes
+// of a periodic mesh repeat the first, and must not be counted twice
+void periodicEnergy(void) {
+  const int n = 40;
+  for (int periodic = 0; periodic < 4; periodic++) {
+    Mesh mesh(n, n, 0.5);
+    if (periodic & 1) mesh.SetBoundary(Mesh::LEFT, Mesh::PERIODIC);
+    if (periodic & 2) mesh.SetBoundary(Mesh::BOTTOM, Mesh::PERIODIC);
+    for (int k = 0; k < mesh.Nx*mesh.Ny; k++) {
+      mesh.Vxn[k] = 2.0;
+      mesh.Vyn[k] = 0.0;
+    }
+    double exact = 0.5 * 4.0 * (n*mesh.dx) * (n*mesh.dx);
+    Diagnostics::Sample s = Diagnostics::Measure(mesh);
+    char what[64];
+    snprintf(what, sizeof(what), "uniform flow: energy, periodic in %s",
+	     (periodic == 0) ? "neither" : (periodic == 1) ? "x" : (periodic == 2) ? "y" : "x and y");
+    check(std::abs(s.energy - exact) < 1.0e-6 * exact, what);
+    check(s.speed == 2.0, "uniform flow: speed");
+  }
+} // periodicEnergy
+
+int main(int argc, char** argv) {
+  clearAfterPadding();
+  constantAtWalls();
+  periodicEnergy();
+  return failures;
+}
@@ -0,0 +1,70 @@
+// Measure the error vs. runtime trade-off of the lumped-mass remap, relative
+// to the consistent-mass (iterative) remap, on the initial conditions image.
+//
+// usage: ./remap_benchmark [steps] [dt] [max_sweeps]
+
+// include project headers
+#include "mesh.h"   // Mesh
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi, atof
+#include<cmath>     // sqrt
+#include<chrono>    // steady_clock
+
+// include CImg for reading image files
+#include "CImg.h"
+using namespace cimg_library;
+
+// relative L2 difference between two arrays
+float difference(float* x, float* y, int n) {
+  float num = 0.0;
+  float den = 0.0;
+  for (int i = 0; i < n; i++) {
+    num += (x[i]-y[i])*(x[i]-y[i]);
+    den += y[i]*y[i];
+  }
+  return std::sqrt(num/std::max(den,1.0e-30f));
+}
+
+// advance a mesh by a number of steps, returning the time per step (in ms)
+double run(Mesh* mesh, int steps, float dt) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int n = 0; n < steps; n++) {
+    mesh->UpdateFields(dt);
+  }
+  std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double,std::milli>(stop - start).count() / steps;
+}
+
+int main(int argc, char** argv) {
+  int steps      = (argc > 1) ? std::atoi(argv[1]) : 200;
+  float dt       = (argc > 2) ? std::atof(argv[2]) : 0.02;
+  int max_sweeps = (argc > 3) ? std::atoi(argv[3]) : 8;
+
+  CImg<float> image("initial_conditions.png");
+
+  // reference solution: consistent mass matrix, solved to tolerance
+  Mesh reference(image);
+  double time = run(&reference, steps, dt);
+  int nn = reference.Nx*reference.Ny;
+  int ne = reference.Ex*reference.Ey;
+  std::cout << "# " << reference.Ex << "x" << reference.Ey << " elements, "
+            << steps << " steps, dt = " << dt << std::endl;
+  std::cout << "# mode        ms/step   err(He)       err(Vx)       err(Vy)" << std::endl;
+  std::cout << "consistent    " << time << std::endl;
+
+  // lumped mass matrix, with an increasing number of correction sweeps
+  for (int k = 0; k <= max_sweeps; k++) {
+    Mesh mesh(image);
+    mesh.lumped = true;
+    mesh.sweeps = k;
+    time = run(&mesh, steps, dt);
+    std::cout << "lumped+" << k << "      " << time
+              << "   " << difference(mesh.He,  reference.He,  ne)
+              << "   " << difference(mesh.Vxn, reference.Vxn, nn)
+              << "   " << difference(mesh.Vyn, reference.Vyn, nn) << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+// Compare the semi-Lagrangian backtrace with the Galerkin remap, side by
+// side: a slotted disc of dye makes one turn in a solid-body rotation
+// (velocities held fixed), and the run time of the turn, and the L1 error
+// against the initial disc, are reported for each engine, mesh size and
+// Courant number (on the middle of the sides). The cost of a step is that
+// of forming the operator (the integral operator, or the departure
+// stencils) and advecting the field, which are reported together (as the
+// engines are compared on), and the advection alone. The remap is only run at Courant number 1/2; the
+// backtrace is run with scalar and gathered (AVX2) sampling, and with the
+// MacCormack correction.
+//
+// usage: ./semi_lagrangian_benchmark [max_size] [lumped]
+
+// include project headers
+#include "mesh.h"         // Mesh
+#include "fixed_mesh.h"   // NewMesh
+#include "slotted_disc.h" // slottedDisc
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi
+#include<cmath>     // abs
+#include<vector>    // vector
+#include<chrono>    // steady_clock
+
+// make one turn at a Courant number, and report the timings and the error
+void run(const char* name, int n, int engine, bool gather, int correction, bool lumped,
+         float courant) {
+  Mesh* mesh = NewMesh(n, n, 1.0);
+  mesh->lumped = lumped;
+  mesh->engine = engine;
+  mesh->gather = mesh->gather && gather;
+  mesh->correction = correction;
+  std::vector<float> exact;
+  slottedDisc(mesh, exact);
+  int steps = int(3.14159265 * n / courant) + 1;
+  mesh->dt = 1.0 / steps;
+
+  double form = 0.0, advect = 0.0;
+  for (int s = 0; s < steps; s++) {
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    mesh->UpdateIntegralOperator();
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    mesh->UpdateElementField(mesh->He);
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    form   += std::chrono::duration<double,std::milli>(t1 - t0).count();
+    advect += std::chrono::duration<double,std::milli>(t2 - t1).count();
+  }
+
+  double error = 0.0;
+  for (int e = 0; e < n*n; e++) {
+    error += std::abs(mesh->He[e] - exact[e]);
+  }
+  error /= double(n) * n;
+  std::cout << name << "   " << n << "    " << courant << "      " << steps << "    "
+            << form + advect << "    " << 1.0e6 * (form + advect) / (double(steps)*n*n)
+            << "    " << advect << "    " << 1.0e6 * advect / (double(steps)*n*n)
+            << "    " << error << std::endl;
+  delete mesh;
+}
+
+int main(int argc, char** argv) {
+  int max_size = (argc > 1) ? std::atoi(argv[1]) : 256;
+  bool lumped  = (argc > 2) ? std::atoi(argv[2]) : 1;
+  std::cout << "# engine                size   courant  steps   form+advect (ms/turn)"
+            << "   (ns/element/step)   advect only (ms/turn)   (ns/element/step)   L1 error"
+            << std::endl;
+  for (int n = 64; n <= max_size; n *= 2) {
+    run("remap                ", n, Mesh::GALERKIN, false, Mesh::FIRST_ORDER, lumped, 0.5);
+    run("remap+maccormack     ", n, Mesh::GALERKIN, false, Mesh::MACCORMACK, lumped, 0.5);
+    float courants[] = { 0.5, 2.0, 8.0 };
+    for (int c = 0; c < 3; c++) {
+      run("backtrace (scalar)   ", n, Mesh::SEMI_LAGRANGIAN, false, Mesh::FIRST_ORDER, lumped, courants[c]);
+      run("backtrace (gather)   ", n, Mesh::SEMI_LAGRANGIAN, true, Mesh::FIRST_ORDER, lumped, courants[c]);
+      run("backtrace+maccormack ", n, Mesh::SEMI_LAGRANGIAN, true, Mesh::MACCORMACK, lumped, courants[c]);
+    }
+  }
+  return 0;
+}
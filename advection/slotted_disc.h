@@ -0,0 +1,37 @@
+#ifndef SLOTTED_DISC_H
+#define SLOTTED_DISC_H
+
+// include standard C/C++ libraries
+#include <cmath>     // abs
+#include <vector>    // vector
+
+// include project headers
+#include "mesh.h"    // Mesh
+
+// The slotted disc test of the advection benchmarks: the mesh (of unit
+// elements) rotates about its center with a period of 1 second, and carries
+// a disc of dye (radius 0.15, centered at (0.5,0.75) of the sides) with a
+// slot 0.05 wide. The velocities are set on the nodes, and the disc in the
+// pressure head and in exact (the solution after every full turn).
+inline void slottedDisc(Mesh* mesh, std::vector<float>& exact) {
+  const int Ex = mesh->Ex, Ey = mesh->Ey, Nx = mesh->Nx;
+  const float w = 2.0 * 3.14159265;
+  for (int j = 0; j <= Ey; j++) {
+    for (int i = 0; i <= Ex; i++) {
+      mesh->Vxn[Nx*j+i] = -w * (j - 0.5*Ey);
+      mesh->Vyn[Nx*j+i] = +w * (i - 0.5*Ex);
+    }
+  }
+  exact.resize(Ex*Ey);
+  for (int j = 0; j < Ey; j++) {
+    for (int i = 0; i < Ex; i++) {
+      float x = (i + 0.5) / Ex, y = (j + 0.5) / Ey;
+      bool disc = (x-0.5)*(x-0.5) + (y-0.75)*(y-0.75) < 0.15*0.15;
+      bool slot = (std::abs(x-0.5) < 0.025) && (y < 0.85);
+      exact[Ex*j+i] = (disc && !slot) ? 1.0 : 0.0;
+      mesh->He[Ex*j+i] = exact[Ex*j+i];
+    }
+  }
+} // slottedDisc
+
+#endif // SLOTTED_DISC_H
@@ -0,0 +1,105 @@
+#ifndef STROKES_H
+#define STROKES_H
+
+// include standard C/C++ libraries
+#include <cmath>     // floor, ceil
+#include <algorithm> // min, max
+#include <atomic>    // atomic
+
+// include project headers
+#include "mesh.h"    // Mesh
+
+// Brush strokes painted on the pressure head of a mesh.
+//
+// Pointer events are buffered in a lock-free single-producer/single-consumer
+// ring buffer, so that input callbacks never touch the fields; the solver
+// drains the buffer at step boundaries, and paints every stroke as the union
+// of discs of the brush radius along the segments between consecutive
+// samples (so that fast strokes leave no gaps).
+class Strokes {
+public:
+
+  enum { CAPACITY = 1024 }; // Ring buffer capacity (a power of 2)
+
+  struct Event {
+    float x, y; // Position, in element units
+    bool start; // First sample of a stroke
+  };
+
+  float radius; // Brush radius, in element units
+  float value;  // Painted pressure head
+
+  Strokes() {
+    radius = 1.5;
+    value = 1.0;
+    head = 0;
+    tail = 0;
+    drawing = false;
+  } // Strokes
+
+  bool Push(float x, float y, bool start) {
+    // Queue a pointer event (producer side); events are dropped when the
+    // buffer is full
+    unsigned h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == CAPACITY) return false;
+    events[h % CAPACITY] = {x, y, start};
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  } // Push
+
+  int Apply(Mesh& mesh) {
+    // Paint all queued strokes (consumer side), returning the number of
+    // events consumed
+    unsigned t = tail.load(std::memory_order_relaxed);
+    unsigned h = head.load(std::memory_order_acquire);
+    for (unsigned k = t; k != h; k++) {
+      const Event& e = events[k % CAPACITY];
+      if (e.start || !drawing) {
+	Segment(mesh, e.x, e.y, e.x, e.y);
+      } else {
+	Segment(mesh, x0, y0, e.x, e.y);
+      }
+      x0 = e.x;
+      y0 = e.y;
+      drawing = true;
+    }
+    tail.store(h, std::memory_order_release);
+    return h - t;
+  } // Apply
+
+private:
+
+  Event events[CAPACITY];
+  std::atomic<unsigned> head; // Next event to write
+  std::atomic<unsigned> tail; // Next event to read
+  float x0, y0;               // Last painted sample
+  bool drawing;               // A stroke has been started
+
+  void Segment(Mesh& mesh, float xa, float ya, float xb, float yb) {
+    // Paint the (fluid) elements whose centers lie within the brush radius
+    // of the segment from (xa,ya) to (xb,yb)
+    int i0 = std::max(int(std::floor(std::min(xa,xb) - radius)), 0);
+    int i1 = std::min(int(std::ceil(std::max(xa,xb) + radius)), mesh.Ex-1);
+    int j0 = std::max(int(std::floor(std::min(ya,yb) - radius)), 0);
+    int j1 = std::min(int(std::ceil(std::max(ya,yb) + radius)), mesh.Ey-1);
+    float dx = xb - xa;
+    float dy = yb - ya;
+    float d2 = dx*dx + dy*dy;
+    for (int j = j0; j <= j1; j++) {
+      for (int i = i0; i <= i1; i++) {
+	// distance from the element center to the closest point of the segment
+	float px = i + 0.5 - xa;
+	float py = j + 0.5 - ya;
+	float s = (d2 > 0.0) ? std::min(std::max((px*dx + py*dy) / d2, 0.0f), 1.0f) : 0.0;
+	float qx = px - s*dx;
+	float qy = py - s*dy;
+	if ((qx*qx + qy*qy <= radius*radius) && !mesh.Solid(i,j)) {
+	  mesh.He[mesh.Ex*j+i] = value;
+	}
+      }
+    }
+  } // Segment
+
+};
+
+#endif // STROKES_H
@@ -0,0 +1,73 @@
+// Measure the cost of the particle-mesh coupling (binning by element,
+// bilinear sampling, drag, and the scatter of the reaction forces), for
+// 10k to 1M tracers on a 512x512 mesh, with one- and two-way coupling.
+//
+// usage: ./tracer_benchmark [steps] [max_tracers]
+
+// include project headers
+#include "mesh.h"       // Mesh
+#include "fixed_mesh.h" // NewMesh
+#include "tracers.h"    // Tracers
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi
+#include<cmath>     // exp
+#include<chrono>    // steady_clock
+
+// initialize a mesh with a Gaussian bump of pressure head, and spin it up
+Mesh* initialize(int n, float dt) {
+  Mesh* mesh = NewMesh(n, n, 1.0);
+  mesh->lumped = true;
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      float x = (i + 0.5) / n - 0.5;
+      float y = (j + 0.5) / n - 0.5;
+      mesh->He[n*j+i] = std::exp(-50.0*(x*x+y*y));
+    }
+  }
+  for (int s = 0; s < 5; s++) {
+    mesh->UpdateFields(dt);
+  }
+  return mesh;
+}
+
+// time per step (in ms) of the tracer update
+double run(Tracers* tracers, int steps, float dt) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int n = 0; n < steps; n++) {
+    tracers->Update(dt);
+  }
+  std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double,std::milli>(stop - start).count() / steps;
+}
+
+int main(int argc, char** argv) {
+  int steps = (argc > 1) ? std::atoi(argv[1]) : 20;
+  int max_tracers = (argc > 2) ? std::atoi(argv[2]) : 1000000;
+  float dt = 0.02;
+  Mesh* mesh = initialize(512, dt);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int n = 0; n < steps; n++) {
+    mesh->UpdateFields(dt);
+  }
+  std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+  std::cout << "# 512x512 mesh: "
+            << std::chrono::duration<double,std::milli>(stop - start).count() / steps
+            << " ms/step" << std::endl;
+
+  std::cout << "# tracers    one-way (ms/step)   (ns/tracer)   two-way (ms/step)   (ns/tracer)" << std::endl;
+  for (int n = 10000; n <= max_tracers; n *= 10) {
+    Tracers* tracers = new Tracers(mesh, n);
+    double t0 = run(tracers, steps, dt);
+    tracers->feedback = true;
+    double t1 = run(tracers, steps, dt);
+    std::cout << n << "       " << t0 << "             " << 1.0e6*t0/n
+              << "          " << t1 << "             " << 1.0e6*t1/n << std::endl;
+    delete tracers;
+  }
+
+  delete mesh;
+  return 0;
+}
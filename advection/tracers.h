@@ -0,0 +1,170 @@
+#ifndef TRACERS_H
+#define TRACERS_H
+
+// include standard C/C++ libraries
+#include <cmath>     // abs
+#include <cstring>   // memset, memcpy
+#include <cstdlib>   // rand
+#include <algorithm> // min, max
+
+// include project headers
+#include "mesh.h"               // Mesh
+#include "../ball/particles.h"  // Particles
+
+// Balls carried by the flow of a mesh: each ball feels a quadratic drag
+// against the fluid velocity, sampled (bilinearly) from the nodal velocity
+// fields, and may push back on the fluid (two-way coupling) through the
+// nodal body forces of the mesh.
+//
+// The balls live in the box [-1,+1]x[-1,+1], which spans the mesh. At every
+// step they are sorted by mesh element (counting sort), so that the four
+// nodal velocities of an element are loaded once for all of its balls, and
+// the reaction forces are accumulated per element before being scattered
+// to its nodes.
+class Tracers {
+public:
+
+  Mesh* mesh;       // Carrier flow
+  Particles* balls; // Tracer particles
+
+  // Coupling parameters
+  float drag;    // Quadratic drag coefficient against the fluid
+  bool feedback; // Two-way coupling: apply the reaction forces to the fluid
+  bool collide;  // Resolve ball-ball collisions (and wall contact)
+
+  // Element binning
+  int* start; // First ball of each element, in sorted order [Ex*Ey+1]
+
+  Tracers(Mesh* m, int n) {
+    // Scatter n balls at random, at rest, with a radius of half an element;
+    // together they weigh a tenth of the fluid (unit density)
+    mesh = m;
+    balls = new Particles(n);
+    balls->gravity = 0.0;
+    balls->drag = 0.0;
+    balls->mass = 0.1 * mesh->Ex * mesh->Ey * mesh->dx * mesh->dx / n;
+    float r = 1.0 / std::max(mesh->Ex, mesh->Ey);
+    for (int p = 0; p < n; p++) {
+      balls->x[p] = (2.0*rand()/RAND_MAX - 1.0)*(1.0 - r);
+      balls->y[p] = (2.0*rand()/RAND_MAX - 1.0)*(1.0 - r);
+      balls->r[p] = r;
+    }
+    drag = 50.0;
+    feedback = false;
+    collide = false;
+    start = new int[mesh->Ex*mesh->Ey+1];
+  } // Tracers
+
+  ~Tracers() {
+    delete balls;
+    delete[] start;
+  } // ~Tracers
+
+  void Update(float dt) {
+    // Bin the balls by element, and exchange momentum with the fluid
+    Bin();
+    Couple(dt);
+
+    // Integrate the equations of motion of the balls
+    if (collide) {
+      balls->update(dt);
+    } else {
+      memcpy(balls->x0, balls->x, balls->N*sizeof(float));
+      memcpy(balls->y0, balls->y, balls->N*sizeof(float));
+      balls->advance(dt);
+    }
+  } // Update
+
+  void Bin(void) {
+    // Sort the balls by element (stable counting sort)
+    const int Ex = mesh->Ex, Ey = mesh->Ey, N = balls->N;
+    memset(start, 0, (Ex*Ey+1)*sizeof(int));
+    for (int p = 0; p < N; p++) {
+      int i = std::min(std::max(int((balls->x[p] + 1.0) * 0.5 * Ex), 0), Ex-1);
+      int j = std::min(std::max(int((balls->y[p] + 1.0) * 0.5 * Ey), 0), Ey-1);
+      balls->cell[p] = Ex*j+i;
+      start[Ex*j+i+1]++;
+    }
+    for (int e = 0; e < Ex*Ey; e++) {
+      start[e+1] += start[e];
+    }
+    for (int p = 0; p < N; p++) {
+      balls->order[p] = start[balls->cell[p]]++;
+    }
+    for (int e = Ex*Ey; e > 0; e--) {
+      start[e] = start[e-1];
+    }
+    start[0] = 0;
+
+    // Reorder the particle arrays
+    balls->permute(balls->x);
+    balls->permute(balls->y);
+    balls->permute(balls->vx);
+    balls->permute(balls->vy);
+    balls->permute(balls->r);
+  } // Bin
+
+  void Couple(float dt) {
+    // Relax the velocity of each ball towards the local fluid velocity,
+    // implicitly (the relative velocity w decays as w/(1+c|w|dt), which is
+    // stable for any time step), and accumulate the reaction forces
+    const int Ex = mesh->Ex, Ey = mesh->Ey, Nx = Ex + 1, Ny = Ey + 1;
+    const float sx = 0.5 * Ex * mesh->dx; // mesh lengths per box length
+    const float sy = 0.5 * Ey * mesh->dx;
+    const float c = drag * dt;
+    float* x = balls->x;
+    float* y = balls->y;
+    float* vx = balls->vx;
+    float* vy = balls->vy;
+    if (feedback) mesh->EnableBodyForce();
+    if (mesh->Fxn != NULL) {
+      memset(mesh->Fxn, 0, Nx*Ny*sizeof(float));
+      memset(mesh->Fyn, 0, Nx*Ny*sizeof(float));
+    }
+    for (int j = 0; j < Ey; j++) {
+      for (int i = 0; i < Ex; i++) {
+	int e = Ex*j+i;
+	if (start[e] == start[e+1]) continue;
+
+	// nodes of the element, counter-clockwise from the bottom-left
+	const int n[4] = {Nx*j+i, Nx*j+i+1, Nx*(j+1)+i+1, Nx*(j+1)+i};
+	float u[4], v[4], fx[4] = {0, 0, 0, 0}, fy[4] = {0, 0, 0, 0};
+	for (int k = 0; k < 4; k++) {
+	  u[k] = mesh->Vxn[n[k]] / sx;
+	  v[k] = mesh->Vyn[n[k]] / sy;
+	}
+
+	for (int p = start[e]; p < start[e+1]; p++) {
+	  // bilinear weights of the ball center within the element
+	  float X = std::min(std::max((x[p] + 1.0f) * 0.5f * Ex - i, 0.0f), 1.0f);
+	  float Y = std::min(std::max((y[p] + 1.0f) * 0.5f * Ey - j, 0.0f), 1.0f);
+	  float w[4] = {(1-X)*(1-Y), X*(1-Y), X*Y, (1-X)*Y};
+
+	  // drag against the sampled fluid velocity
+	  float wx = vx[p] - (w[0]*u[0] + w[1]*u[1] + w[2]*u[2] + w[3]*u[3]);
+	  float wy = vy[p] - (w[0]*v[0] + w[1]*v[1] + w[2]*v[2] + w[3]*v[3]);
+	  float dvx = wx / (1.0f + c*std::abs(wx)) - wx;
+	  float dvy = wy / (1.0f + c*std::abs(wy)) - wy;
+	  vx[p] += dvx;
+	  vy[p] += dvy;
+	  for (int k = 0; k < 4; k++) {
+	    fx[k] += w[k] * dvx;
+	    fy[k] += w[k] * dvy;
+	  }
+	}
+
+	// reaction forces, as nodal accelerations (in mesh units)
+	if (feedback) {
+	  float scale = -balls->mass / dt;
+	  for (int k = 0; k < 4; k++) {
+	    mesh->Fxn[n[k]] += scale * sx * fx[k] * mesh->Wn[n[k]];
+	    mesh->Fyn[n[k]] += scale * sy * fy[k] * mesh->Wn[n[k]];
+	  }
+	}
+      }
+    }
+  } // Couple
+
+};
+
+#endif // TRACERS_H
@@ -0,0 +1,109 @@
+#ifndef CIRCLES_H
+#define CIRCLES_H
+
+// include glut.h with cross-platform support
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+// include project headers
+#include "particles.h" // Particles
+
+// include standard C/C++ libraries
+#include <cmath>     // atan, cos, sin, sqrt
+#include <cstring>   // memset
+#include <algorithm> // min, max
+
+// A renderer for the balls of a particle system. Every ball is a fan of K
+// triangles around its center, shaded from a light center to the base
+// color at the rim. The fan of the unit circle is recorded once, in a
+// display list, and each ball replays it translated to its center and
+// scaled to its radius: a frame only sends the position and radius of each
+// ball, and builds no geometry.
+//
+// For headless capture, the same balls can be rasterized on the CPU into an
+// RGB image.
+class Circles {
+public :
+
+  int K;          // Number of triangles per ball
+  float color[3]; // Base (rim) color
+  GLuint list;    // Unit circle (0 until the first frame)
+
+  Circles(int k = 20) {
+    K = k;
+    list = 0;
+    color[0] = 1.0;
+    color[1] = 0.0;
+    color[2] = 0.0;
+  } // Circles
+
+  void setColor(float r, float g, float b) {
+    color[0] = r;
+    color[1] = g;
+    color[2] = b;
+    if (list != 0) { // record the unit circle again
+      glDeleteLists(list, 1);
+      list = 0;
+    }
+  } // setColor
+
+  void draw(const Particles& balls, float alpha) {
+    // draw the balls, interpolated between the last two steps
+    if (list == 0) {
+      // record the unit circle at the first frame (once the GL context
+      // exists): a fan from the light center around the rim
+      float pi = 4.0 * std::atan(1.0);
+      list = glGenLists(1);
+      glNewList(list, GL_COMPILE);
+      glBegin(GL_TRIANGLE_FAN);
+      glColor3f(color[0] + 0.5, color[1] + 0.5, color[2] + 0.5);
+      glVertex2f(0.0, 0.0);
+      glColor3fv(color);
+      for (int k = 0; k <= K; k++) {
+	glVertex2f(std::cos((k%K) * 2.0 * pi / K), std::sin((k%K) * 2.0 * pi / K));
+      }
+      glEnd();
+      glEndList();
+    }
+    for (int p = 0; p < balls.N; p++) {
+      float r = balls.r[p];
+      glPushMatrix();
+      glTranslatef(balls.interpolateX(p, alpha), balls.interpolateY(p, alpha), 0.0);
+      glScalef(r, r, 1.0);
+      glCallList(list);
+      glPopMatrix();
+    }
+  } // draw
+
+  void rasterize(const Particles& balls, float alpha, unsigned char* image, int w, int h) {
+    // rasterize the balls into a w x h RGB image (top row first), with the
+    // same shading as the triangle fans: linear from the center to the rim
+    memset(image, 0, (size_t)w*h*3);
+    for (int p = 0; p < balls.N; p++) {
+      float x = (balls.interpolateX(p, alpha) + 1.0) * 0.5 * w;
+      float y = (1.0 - balls.interpolateY(p, alpha)) * 0.5 * h;
+      float rx = balls.r[p] * 0.5 * w;
+      float ry = balls.r[p] * 0.5 * h;
+      int i0 = std::max(int(x - rx), 0), i1 = std::min(int(x + rx) + 1, w-1);
+      int j0 = std::max(int(y - ry), 0), j1 = std::min(int(y + ry) + 1, h-1);
+      for (int j = j0; j <= j1; j++) {
+	for (int i = i0; i <= i1; i++) {
+	  float dx = (i + 0.5 - x) / rx;
+	  float dy = (j + 0.5 - y) / ry;
+	  float d2 = dx*dx + dy*dy;
+	  if (d2 > 1.0) continue;
+	  float s = 0.5 * (1.0 - std::sqrt(d2));
+	  unsigned char* q = image + 3*((size_t)w*j+i);
+	  for (int m = 0; m < 3; m++) {
+	    q[m] = 255 * std::min(std::max(color[m] + s, 0.0f), 1.0f);
+	  }
+	}
+      }
+    }
+  } // rasterize
+};
+
+#endif // CIRCLES_H
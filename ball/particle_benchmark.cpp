@@ -0,0 +1,117 @@
+// Measure the throughput (particle-steps per second) of the particle
+// integrator, against a branching scalar reference, and of the full update
+// (spatial hash, collisions and integration), for 10k to 10M particles.
+//
+// usage: ./particle_benchmark [steps] [max_update]
+//  -max_update is the largest number of particles for the full update
+
+// include project headers
+#include "particles.h" // Particles
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi, rand
+#include<cmath>     // abs, sqrt
+#include<chrono>    // steady_clock
+
+// scatter n balls at random, covering about a fifth of the box
+void initialize(Particles* balls) {
+  int n = balls->N;
+  float rn = 0.5 / std::sqrt(float(n));
+  srand(1);
+  for (int p = 0; p < n; p++) {
+    balls->x[p]  = (2.0*rand()/RAND_MAX - 1.0)*(1.0 - rn);
+    balls->y[p]  = (2.0*rand()/RAND_MAX - 1.0)*(1.0 - rn);
+    balls->vx[p] = 10.0*(2.0*rand()/RAND_MAX - 1.0);
+    balls->vy[p] = 10.0*(2.0*rand()/RAND_MAX - 1.0);
+    balls->r[p]  = rn;
+  }
+}
+
+// wall contact and integration with branches, as per the original Ball
+void reference(Particles* b, float dt) {
+  for (int p = 0; p < b->N; p++) {
+    if (b->x[p] - b->r[p] <= -1.0) {
+      b->x[p] = -1.0 + b->r[p];
+      b->vx[p] = b->friction * std::abs(b->vx[p]);
+      b->vy[p] *= b->friction;
+    } else if (b->x[p] + b->r[p] >= 1.0) {
+      b->x[p] = 1.0 - b->r[p];
+      b->vx[p] = -b->friction * std::abs(b->vx[p]);
+      b->vy[p] *= b->friction;
+    }
+    if (b->y[p] - b->r[p] <= -1.0) {
+      b->y[p] = -1.0 + b->r[p];
+      b->vy[p] = b->friction * std::abs(b->vy[p]);
+      b->vx[p] *= b->friction;
+    } else if (b->y[p] + b->r[p] >= 1.0) {
+      b->y[p] = 1.0 - b->r[p];
+      b->vy[p] = -b->friction * std::abs(b->vy[p]);
+      b->vx[p] *= b->friction;
+    }
+  }
+  for (int p = 0; p < b->N; p++) {
+    float fx = -b->drag * b->vx[p] * std::abs(b->vx[p]);
+    float fy = -b->drag * b->vy[p] * std::abs(b->vy[p]) - b->mass * b->gravity;
+    b->vx[p] += fx / b->mass * dt;
+    b->vy[p] += fy / b->mass * dt;
+    b->x[p] += b->vx[p] * dt;
+    b->y[p] += b->vy[p] * dt;
+  }
+}
+
+// particle-steps per second (in millions) of a stepping function
+template<class F>
+double run(Particles* balls, int steps, F step) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int n = 0; n < steps; n++) {
+    step();
+  }
+  std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+  double s = std::chrono::duration<double>(stop - start).count();
+  return 1.0e-6 * balls->N * steps / s;
+}
+
+int main(int argc, char** argv) {
+  int steps = (argc > 1) ? std::atoi(argv[1]) : 20;
+  int max_update = (argc > 2) ? std::atoi(argv[2]) : 1000000;
+  float dt = 0.001;
+
+  std::cout << "# threads: " << std::thread::hardware_concurrency() << std::endl;
+  std::cout << "# particles   reference   branch-free   threaded   update   (Mparticle-steps/s)   max |diff|" << std::endl;
+  for (int n = 10000; n <= 10000000; n *= 10) {
+    Particles* a = new Particles(n);
+    Particles* b = new Particles(n);
+    initialize(a);
+    initialize(b);
+
+    // reference against the branch-free integrator, on a single thread
+    b->threads = 1;
+    double r0 = run(a, steps, [&] { reference(a, dt); });
+    double r1 = run(b, steps, [&] { b->advance(dt); });
+    float diff = 0.0;
+    for (int p = 0; p < n; p++) {
+      diff = std::max(diff, std::abs(a->x[p] - b->x[p]));
+      diff = std::max(diff, std::abs(a->y[p] - b->y[p]));
+    }
+
+    // branch-free integrator on all threads
+    b->threads = std::max(1u, std::thread::hardware_concurrency());
+    b->chunk = 10000;
+    double r2 = run(b, steps, [&] { b->advance(dt); });
+    delete a;
+
+    // full update
+    std::cout << n << "       " << r0 << "       " << r1 << "       " << r2 << "       ";
+    if (n <= max_update) {
+      initialize(b);
+      std::cout << run(b, steps, [&] { b->update(dt); });
+    } else {
+      std::cout << "-";
+    }
+    std::cout << "       " << diff << std::endl;
+    delete b;
+  }
+
+  return 0;
+}
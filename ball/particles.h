@@ -0,0 +1,345 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+// include standard C/C++ libraries
+#include <cmath>     // abs, sqrt, copysign
+#include <cstring>   // memcpy
+#include <algorithm> // min, max, swap
+#include <thread>    // hardware_concurrency
+#include <functional> // function
+
+// include project headers
+#include "pool.h"    // Pool
+
+// A system of balls in the box [-1,+1]x[-1,+1], subject to gravity and
+// quadratic drag, with wall contact and ball-ball collisions.
+//
+// The particle data is stored as a structure of arrays. Collisions are
+// detected through a uniform grid (spatial hash), whose cells are at least
+// as wide as the largest ball (and at most four times as many as the
+// balls); the particle arrays are reordered by cell (counting sort) at
+// every step, so that all neighbour searches are local.
+class Particles {
+public :
+
+  // Particle data
+  int N;      // Number of particles
+  float* x;   // x-coordinate [N]
+  float* y;   // y-coordinate [N]
+  float* vx;  // x-velocity   [N]
+  float* vy;  // y-velocity   [N]
+  float* r;   // radius       [N]
+  float* x0;  // x-coordinate at the start of the last step [N]
+  float* y0;  // y-coordinate at the start of the last step [N]
+
+  // Physical parameters
+  float mass;     // particle mass
+  float gravity;  // gravitational acceleration
+  float drag;     // quadratic drag coefficient
+  float friction; // fraction of the velocity retained upon contact
+
+  // Time integration
+  bool verlet; // Velocity Verlet (kick-drift-kick), otherwise semi-implicit Euler
+
+  // Parallelism
+  int threads; // Number of threads for the integrator
+  int chunk;   // Minimum number of particles per thread
+  Pool* pool;  // Threads, or NULL (started with the first parallel step)
+
+  // Spatial hash
+  enum { BAND = 8 }; // Rows of cells per band of the parallel collisions
+  int C;        // Number of cells in each direction
+  float h;      // Cell width
+  int* cell;    // Cell of each particle   [N]
+  int* start;   // First particle of each cell, in sorted order [C*C+1]
+  int* count;   // Particles of each cell, 0 between sorts [C*C]
+  int* order;   // Sorted position of each particle [N]
+  float* work;  // Reordering workspace [N]
+
+  Particles(int n) {
+    N = n;
+    x  = new float[N]();
+    y  = new float[N]();
+    vx = new float[N]();
+    vy = new float[N]();
+    r  = new float[N]();
+    x0 = new float[N]();
+    y0 = new float[N]();
+    mass = 1.0;
+    gravity = 9.8;
+    drag = 0.5;
+    friction = 1.0 - 0.02;
+    verlet = false;
+    threads = std::max(1u, std::thread::hardware_concurrency());
+    chunk = 65536;
+    pool = NULL;
+    C = 0;
+    h = 2.0;
+    cell  = new int[N];
+    start = new int[1];
+    count = new int[1]();
+    order = new int[N];
+    work  = new float[N];
+  } // Particles
+
+  ~Particles() {
+    delete[] x;
+    delete[] y;
+    delete[] vx;
+    delete[] vy;
+    delete[] r;
+    delete[] x0;
+    delete[] y0;
+    delete[] cell;
+    delete[] start;
+    delete[] count;
+    delete[] order;
+    delete[] work;
+    delete pool;
+  } // ~Particles
+
+  // The arrays (and the pool) are owned: no copies
+  Particles(const Particles&) = delete;
+  Particles& operator=(const Particles&) = delete;
+
+  void update(float dt) {
+    // bin the particles, and sort them by cell
+    sort();
+
+    // keep the start positions, for interpolation between steps
+    memcpy(x0, x, N*sizeof(float));
+    memcpy(y0, y, N*sizeof(float));
+
+    // handle ball-ball contact conditions
+    collide();
+
+    // handle wall contact conditions, and integrate the equations of motion
+    advance(dt);
+  } // update
+
+  void advance(float dt) {
+    // split the particles into contiguous ranges, one per thread
+    int T = std::max(1, std::min(threads, N / chunk));
+    parallel(T, [&](int t) { advance(dt, (long(N)*t)/T, (long(N)*(t+1))/T); });
+  } // advance
+
+  void parallel(int n, const std::function<void(int)>& kernel) {
+    // run kernel(0), ..., kernel(n-1) on the threads of the pool (started
+    // once, and again only when the number of threads is changed)
+    if (n <= 1) {
+      for (int t = 0; t < n; t++) {
+	kernel(t);
+      }
+      return;
+    }
+    if ((pool == NULL) || (pool->Size() != threads)) {
+      delete pool;
+      pool = new Pool(threads);
+    }
+    pool->Run(n, kernel);
+  } // parallel
+
+  void advance(float dt, int p0, int p1) {
+    // dispatch to the integrator for the selected scheme
+    if (verlet) {
+      advance<true>(dt, p0, p1);
+    } else {
+      advance<false>(dt, p0, p1);
+    }
+  } // advance
+
+  template<bool VERLET>
+  void advance(float dt, int p0, int p1) {
+    // wall contact and time integration of particles [p0,p1), as
+    // branch-free (vectorizable) arithmetic: walls are handled by masked
+    // selects, and the drag sign by copysign
+    float* __restrict px  = x;
+    float* __restrict py  = y;
+    float* __restrict pvx = vx;
+    float* __restrict pvy = vy;
+    const float* __restrict pr = r;
+    const float mu = friction;
+    const float c = drag / mass;
+    const float g = gravity;
+    for (int p = p0; p < p1; p++) {
+      float xp = px[p], yp = py[p], up = pvx[p], vp = pvy[p], rp = pr[p];
+
+      // x-walls: clamp into the box, and reflect the velocity towards the
+      // center (the sign of -x, once in contact)
+      bool w = ((xp - rp) <= -1.0f) | ((xp + rp) >= +1.0f);
+      xp = std::min(std::max(xp, -1.0f + rp), 1.0f - rp);
+      up = w ? std::copysign(mu * up, -xp) : up;
+      vp = w ? (mu * vp) : vp;
+
+      // y-walls
+      w = ((yp - rp) <= -1.0f) | ((yp + rp) >= +1.0f);
+      yp = std::min(std::max(yp, -1.0f + rp), 1.0f - rp);
+      vp = w ? std::copysign(mu * vp, -yp) : vp;
+      up = w ? (mu * up) : up;
+
+      // gravity and quadratic drag: semi-implicit Euler, or velocity
+      // Verlet with the drag evaluated at the start and at the half-step
+      if (VERLET) {
+	up += -std::copysign(c * up*up, up) * (0.5f*dt);
+	vp += (-g - std::copysign(c * vp*vp, vp)) * (0.5f*dt);
+	xp += up * dt;
+	yp += vp * dt;
+	up += -std::copysign(c * up*up, up) * (0.5f*dt);
+	vp += (-g - std::copysign(c * vp*vp, vp)) * (0.5f*dt);
+      } else {
+	up += -std::copysign(c * up*up, up) * dt;
+	vp += (-g - std::copysign(c * vp*vp, vp)) * dt;
+	xp += up * dt;
+	yp += vp * dt;
+      }
+
+      px[p]  = xp;
+      py[p]  = yp;
+      pvx[p] = up;
+      pvy[p] = vp;
+    }
+  } // advance
+
+  void sort(void) {
+    // size the cells to fit the largest ball, with at most four cells per
+    // ball, so that the cost of the hash does not grow as the balls shrink
+    float rmax = 0.0;
+    for (int p = 0; p < N; p++) {
+      rmax = std::max(rmax, r[p]);
+    }
+    int c = std::max(1, std::min(int(2.0 / std::max(2.0*rmax, 1.0e-6)), int(2.0 * std::sqrt(double(N)))));
+    if (c != C) {
+      C = c;
+      h = 2.0 / C;
+      delete[] start;
+      delete[] count;
+      start = new int[C*C+1];
+      count = new int[C*C](); // zero initialization
+    }
+
+    // count the particles in each cell, and find the first of each
+    for (int p = 0; p < N; p++) {
+      int i = std::min(std::max(int((x[p] + 1.0) / h), 0), C-1);
+      int j = std::min(std::max(int((y[p] + 1.0) / h), 0), C-1);
+      cell[p] = C*j+i;
+      count[C*j+i]++;
+    }
+    start[0] = 0;
+    for (int k = 0; k < C*C; k++) {
+      start[k+1] = start[k] + count[k];
+    }
+
+    // assign each particle its sorted position (stable counting sort): the
+    // particles of a cell fill it from its start, and take its count back
+    // to 0, so that only the occupied cells are ever cleared
+    for (int p = 0; p < N; p++) {
+      int k = cell[p];
+      order[p] = start[k+1] - count[k]--;
+    }
+
+    // reorder the particle arrays
+    permute(x);
+    permute(y);
+    permute(vx);
+    permute(vy);
+    permute(r);
+  } // sort
+
+  float interpolateX(int p, float alpha) const {
+    // x-coordinate at a fraction alpha of the last step
+    return x0[p] + alpha * (x[p] - x0[p]);
+  } // interpolateX
+
+  float interpolateY(int p, float alpha) const {
+    // y-coordinate at a fraction alpha of the last step
+    return y0[p] + alpha * (y[p] - y0[p]);
+  } // interpolateY
+
+  void permute(float*& a) {
+    for (int p = 0; p < N; p++) {
+      work[order[p]] = a[p];
+    }
+    std::swap(a, work);
+  } // permute
+
+  void collide(void) {
+    // resolve ball-ball collisions: each pair of neighbouring cells is
+    // visited once, through a half-stencil of the spatial hash, which only
+    // reaches the next row of cells. The rows are split into bands of BAND
+    // rows: two bands of the same parity never touch the same balls, so
+    // that the even bands, and then the odd bands, are resolved in
+    // parallel, in an order that does not depend on the number of threads
+    const int B = (C + BAND - 1) / BAND;
+    const int T = std::max(1, std::min(threads, N / chunk));
+    for (int parity = 0; parity < 2; parity++) {
+      int n = (B + 1 - parity) / 2;
+      auto band = [&](int b) {
+	int j0 = BAND * (2*b + parity);
+	collide(j0, std::min(j0 + BAND, C));
+      };
+      if (T == 1) {
+	for (int b = 0; b < n; b++) {
+	  band(b);
+	}
+      } else {
+	parallel(n, band);
+      }
+    }
+  } // collide
+
+  void collide(int j0, int j1) {
+    // resolve the collisions of the balls in rows [j0,j1) of cells, with
+    // the balls of the same cell or of a later neighbouring cell
+    const int di[4] = {+1, -1,  0, +1};
+    const int dj[4] = { 0, +1, +1, +1};
+    for (int j = j0; j < j1; j++) {
+      for (int i = 0; i < C; i++) {
+	int c = C*j+i;
+	for (int p = start[c]; p < start[c+1]; p++) {
+	  // same cell
+	  for (int q = p+1; q < start[c+1]; q++) {
+	    resolve(p, q);
+	  }
+	  // neighbouring cells
+	  for (int k = 0; k < 4; k++) {
+	    int ni = i + di[k];
+	    int nj = j + dj[k];
+	    if ((ni < 0) || (ni >= C) || (nj >= C)) continue;
+	    int n = C*nj+ni;
+	    for (int q = start[n]; q < start[n+1]; q++) {
+	      resolve(p, q);
+	    }
+	  }
+	}
+      }
+    }
+  } // collide
+
+  void resolve(int p, int q) {
+    // separate two overlapping balls, and exchange an inelastic impulse
+    // along the line of centers (equal masses)
+    float nx = x[q] - x[p];
+    float ny = y[q] - y[p];
+    float d2 = nx*nx + ny*ny;
+    float rsum = r[p] + r[q];
+    if ((d2 >= rsum*rsum) || (d2 == 0.0)) return;
+    float d = std::sqrt(d2);
+    nx /= d;
+    ny /= d;
+    float overlap = 0.5 * (rsum - d);
+    x[p] -= overlap * nx;
+    y[p] -= overlap * ny;
+    x[q] += overlap * nx;
+    y[q] += overlap * ny;
+    float vn = (vx[q] - vx[p])*nx + (vy[q] - vy[p])*ny;
+    if (vn < 0) {
+      float j = 0.5 * (1.0 + friction) * vn;
+      vx[p] += j * nx;
+      vy[p] += j * ny;
+      vx[q] -= j * nx;
+      vy[q] -= j * ny;
+    }
+  } // resolve
+};
+
+#endif // PARTICLES_H
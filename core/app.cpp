@@ -0,0 +1,269 @@
+// include glut.h with cross-platform support
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+// include project headers
+#include "app.h"   // App
+#include "field.h" // Field::SavePpm
+
+// include standard C/C++ libraries
+#include <iostream>  // cerr
+#include <cstdio>    // FILE, fopen, snprintf
+#include <cstdlib>   // atoi, getenv, exit
+#include <algorithm> // max
+#include <vector>    // vector
+#include <unistd.h>  // usleep
+
+// the running front end, to which the GLUT callbacks are forwarded
+static App* current = NULL;
+
+static void idle(void) {
+  current->idle();
+}
+
+static void display(void) {
+  current->display();
+}
+
+static void reshape(int w, int h) {
+  current->reshape(w, h);
+}
+
+static void keyboard(unsigned char c, int x, int y) {
+  current->keyboard(c, x, y);
+}
+
+static void mouse(int button, int state, int x, int y) {
+  current->mouse(button, state, x, y);
+}
+
+static void motion(int x, int y) {
+  current->motion(x, y);
+}
+
+// seconds elapsed since t
+static double since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+App::App(Simulation* s, const char* t, const char* p, int w, int h) {
+  simulation = s;
+  title = t;
+  prefix = p;
+  width = w;
+  height = h;
+  fps = 0.0;
+  profile = (getenv("PROFILE") != NULL);
+  deterministic = (getenv("DETERMINISTIC") != NULL);
+  stepSeconds = 0.0;
+  renderSeconds = 0.0;
+  steps = 0;
+  frames = 0;
+  time = 0.0;
+  count = 0;
+  hashes = NULL;
+  dragging = false;
+  reported = std::chrono::steady_clock::now();
+} // App
+
+int App::run(int argc, char** argv) {
+  // hash log, if requested
+  if (deterministic) {
+    char filename[256];
+    snprintf(filename, sizeof(filename), "%s_hashes.txt", prefix);
+    hashes = fopen(filename, "w");
+    if (hashes == NULL) std::cerr << "cannot write " << filename << std::endl;
+  }
+
+  // headless capture, if requested
+  const char* headless = getenv("HEADLESS");
+  if ((headless != NULL) && (atoi(headless) > 0)) {
+    return runHeadless(atoi(headless), 1.0 / 60.0);
+  }
+  current = this;
+
+  // initialize glut
+  glutInit(&argc, argv);
+
+  // specify the initial position of the display window
+  //  -default value is (-1,-1), leading to automatic window placement
+  glutInitWindowPosition(100, 100);
+
+  // specify the initial size of the display window (in pixels)
+  glutInitWindowSize(width, height);
+
+  // initialize the display modes:
+  // -define colors via RGBA values
+  // -use double buffering (for smoother animations)
+  // -use depth buffering (to correctly occlude objects with greater depth)
+  glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+
+  // create the display window with the specified name
+  glutCreateWindow(title);
+
+  // define call-back functions:
+  // -main display function to run if there is a state change
+  glutDisplayFunc(::display);
+  // -function to run in response to window resizing
+  glutReshapeFunc(::reshape);
+  // -function to run in response to keyboard input
+  glutKeyboardFunc(::keyboard);
+  // -functions to run in response to mouse input (and drags)
+  glutMouseFunc(::mouse);
+  glutMotionFunc(::motion);
+  // -function to run if no active input is provided
+  glutIdleFunc(::idle);
+
+  // enter main display loop
+  glutMainLoop();
+
+  // the program should never reach this point; return 1 if it does
+  return 1;
+} // run
+
+int App::runHeadless(int n, float dt) {
+  // step with a fixed time step, rasterizing each frame on the CPU into
+  // <prefix>_NNNN.ppm (if the simulation supports it)
+  std::vector<unsigned char> image((size_t)width*height*3);
+  char filename[256];
+  for (int f = 0; f < n; f++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    simulation->step(dt);
+    stepSeconds += since(start);
+    steps++;
+    logHash();
+    simulation->refresh();
+    start = std::chrono::steady_clock::now();
+    if (!simulation->rasterize(image.data(), width, height)) continue;
+    renderSeconds += since(start);
+    frames++;
+    snprintf(filename, sizeof(filename), "%s_%04d.ppm", prefix, f);
+    if (!Field::SavePpm(filename, image.data(), width, height)) {
+      std::cerr << "cannot write " << filename << std::endl;
+      return 1;
+    }
+  }
+  if (profile) report();
+  if (hashes != NULL) fclose(hashes);
+  return 0;
+} // runHeadless
+
+void App::report(void) {
+  // report the average cost of a step and of a frame, and start over
+  std::cerr << title << ": " << steps << " steps, "
+	    << 1000.0 * stepSeconds / std::max(steps, 1L) << " ms/step; "
+	    << frames << " frames, "
+	    << 1000.0 * renderSeconds / std::max(frames, 1L) << " ms/frame" << std::endl;
+  stepSeconds = 0.0;
+  renderSeconds = 0.0;
+  steps = 0;
+  frames = 0;
+  reported = std::chrono::steady_clock::now();
+} // report
+
+void App::idle(void) {
+  // step with the elapsed time, or the fixed time step when deterministic
+  // (sleeping first, if the frame rate is capped), and redraw if anything
+  // visibly changed
+  float t = glutGet(GLUT_ELAPSED_TIME);
+  float dt = t - time;
+  if ((fps > 0.0) && (dt < 1000.0 / fps)) {
+    usleep(1000 * (1000.0 / fps - dt));
+    return;
+  }
+  time = t;
+  if (deterministic) dt = 1000.0 / 60.0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  simulation->step(dt / 1000);
+  stepSeconds += since(start);
+  steps++;
+  logHash();
+  if (simulation->refresh()) {
+    glutPostRedisplay(); // refresh the display
+  }
+  if (profile && (since(reported) >= 1.0)) report();
+} // idle
+
+void App::logHash(void) {
+  // append the hash of the state after the step (if supported)
+  uint64_t h;
+  count++;
+  if ((hashes != NULL) && simulation->hash(&h)) {
+    fprintf(hashes, "%ld %016llx\n", count, (unsigned long long)h);
+  }
+} // logHash
+
+void App::display(void) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // clear the current bit buffers, restoring them to their preset values
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  simulation->render();
+
+  // for double buffering: display buffer that was just rendered
+  glutSwapBuffers();
+
+  renderSeconds += since(start);
+  frames++;
+} // display
+
+void App::reshape(int w, int h) {
+  // Prevent a divide by zero, when window is too short
+  // (you cant make a window of zero width).
+  if (h == 0) {h = 1;}
+  float ratio = (1.0 * w) / h;
+
+  // change pixel dimension of the window
+  width = w;
+  height = h;
+
+  // Use the Projection Matrix
+  glMatrixMode(GL_PROJECTION);
+
+  // Reset Matrix
+  glLoadIdentity();
+
+  // Set the viewport to be the entire window
+  // -1st & 2nd args: (x,y) coordinate of the bottom-left viewport corner
+  // -3rd & 4th args: (x,y) coordinate of the top-right viewport corner
+  glViewport(0, 0, w, h);
+
+  // Set the correct perspective.
+  // -1st arg: field of view angle in yz plane
+  // -2nd arg: (re-)define width-to-height ratio of the viewport
+  // -3rd arg: depth value of near clipping plane
+  // -4th arg: depth value of far clipping plane
+  gluPerspective(0,ratio,0,1000);
+
+  // Get Back to the Modelview
+  // -uses the scaling matrix in other glut functions, as needed
+  glMatrixMode(GL_MODELVIEW);
+} // reshape
+
+void App::keyboard(unsigned char c, int x, int y) {
+  if (c == 27) { // ASCII code for the escape key
+    if (profile) report();
+    exit(0);
+  }
+  simulation->keyboard(c);
+} // keyboard
+
+void App::mouse(int button, int state, int x, int y) {
+  if (button != GLUT_LEFT_BUTTON) return;
+  dragging = (state == GLUT_DOWN);
+  if (dragging) pointer(x, y, true);
+} // mouse
+
+void App::motion(int x, int y) {
+  if (dragging) pointer(x, y, false);
+} // motion
+
+void App::pointer(int x, int y, bool start) {
+  // forward the pointer position, in [-1,+1]x[-1,+1] with y up
+  simulation->pointer((2.0 / width) * x - 1.0, 1.0 - (2.0 / height) * y, start);
+  glutPostRedisplay(); // refresh the display
+} // pointer
@@ -0,0 +1,67 @@
+#ifndef APP_H
+#define APP_H
+
+// include project headers
+#include "simulation.h" // Simulation
+
+// include standard C/C++ libraries
+#include <chrono>   // steady_clock
+#include <cstdio>   // FILE
+
+// The front end shared by all simulations: a GLUT window, which steps the
+// simulation with the elapsed time whenever idle and redraws it when its
+// display changed, or a headless loop, which steps it with a fixed time step
+// and writes every frame as a binary PPM file (<prefix>_NNNN.ppm).
+//
+// run() opens the window, unless the HEADLESS environment variable holds a
+// number of frames to capture instead. With the PROFILE environment
+// variable set, the time spent stepping and drawing is reported (on the
+// standard error) every second, and at the end of a headless run. With the
+// DETERMINISTIC environment variable set, the window also steps with the
+// fixed time step (so that two runs without input match), and the hash of
+// the state after every step is written to <prefix>_hashes.txt, one
+// "step hash" line per step, for the runs to be compared with diff.
+class App {
+public :
+
+  Simulation* simulation;
+  const char* title;  // Window title
+  const char* prefix; // Headless frame file prefix
+  int width, height;  // Window size (pixels)
+  float fps;          // Largest frame rate (0 for unlimited)
+  bool profile;       // Report timings
+  bool deterministic; // Fixed time step, and hashes of the states
+
+  // Profile (since the last report)
+  double stepSeconds;   // Time spent stepping
+  double renderSeconds; // Time spent drawing
+  long steps;           // Number of steps
+  long frames;          // Number of drawn frames
+
+  App(Simulation* s, const char* title, const char* prefix, int width, int height);
+
+  int run(int argc, char** argv);
+  int runHeadless(int frames, float dt);
+  void report(void);
+
+  // GLUT callbacks
+  void idle(void);
+  void display(void);
+  void reshape(int w, int h);
+  void keyboard(unsigned char c, int x, int y);
+  void mouse(int button, int state, int x, int y);
+  void motion(int x, int y);
+
+private :
+
+  float time;     // Elapsed time at the last step (ms)
+  long count;     // Steps since the start
+  FILE* hashes;   // Hash log, or NULL
+  bool dragging;  // The left mouse button is down
+  std::chrono::steady_clock::time_point reported; // Time of the last report
+
+  void pointer(int x, int y, bool start);
+  void logHash(void);
+};
+
+#endif // APP_H
@@ -0,0 +1,111 @@
+// include project headers
+#include "canvas.h" // Canvas
+
+// include standard C/C++ libraries
+#include <cstring>   // memset
+#include <algorithm> // min, max
+
+Canvas::Canvas() {
+  Nx = Ny = 0;
+  Tx = Ty = 0;
+  threshold = 0.5 / 255.0;
+  colors = NULL;
+  dirty = NULL;
+  texture = 0;
+} // Canvas
+
+Canvas::~Canvas() {
+  delete[] colors;
+  delete[] dirty;
+} // ~Canvas
+
+void Canvas::initialize(int nx, int ny) {
+  // (re)size the grid; a texture of the previous size is recreated at the
+  // next upload
+  if (texture != 0) {
+    glDeleteTextures(1, &texture);
+    texture = 0;
+  }
+  Nx = nx;
+  Ny = ny;
+  Tx = (Nx+T-1)/T;
+  Ty = (Ny+T-1)/T;
+  delete[] colors;
+  delete[] dirty;
+  colors = new float[3*Nx*Ny](); // zero initialization
+  dirty = new bool[Tx*Ty];
+  for (int t = 0; t < Tx*Ty; t++) {
+    dirty[t] = true; // upload all tiles at first
+  }
+} // initialize
+
+bool Canvas::changed(void) {
+  // whether any tile is awaiting upload
+  for (int t = 0; t < Tx*Ty; t++) {
+    if (dirty[t]) return true;
+  }
+  return false;
+} // changed
+
+int Canvas::upload(void) {
+  // upload the dirty tiles, returning the number of uploaded cells
+  int count = 0;
+  if (texture == 0) {
+    // create the texture, with one (unfiltered) texel per cell
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Nx, Ny, 0, GL_RGB, GL_FLOAT, NULL);
+  }
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, Nx);
+  for (int tj = 0; tj < Ty; tj++) {
+    for (int ti = 0; ti < Tx; ti++) {
+      if (!dirty[Tx*tj+ti]) continue;
+      // extend the rectangle over the run of dirty tiles
+      int tk = ti;
+      while ((tk+1 < Tx) && dirty[Tx*tj+tk+1]) tk++;
+      int i0 = T*ti, i1 = std::min(T*(tk+1), Nx);
+      int j0 = T*tj, j1 = std::min(T*(tj+1), Ny);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, i0, j0, i1-i0, j1-j0, GL_RGB, GL_FLOAT,
+		      colors + 3*(Nx*j0+i0));
+      memset(dirty + Tx*tj+ti, 0, (tk-ti+1)*sizeof(bool));
+      count += (i1-i0)*(j1-j0);
+      ti = tk;
+    }
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  return count;
+} // upload
+
+void Canvas::draw(void) {
+  // draw the cells, modulated by the current color
+  glEnable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  glBegin(GL_QUADS);
+  glTexCoord2f(0.0, 0.0); glVertex2f(-1.0, -1.0);
+  glTexCoord2f(1.0, 0.0); glVertex2f(+1.0, -1.0);
+  glTexCoord2f(1.0, 1.0); glVertex2f(+1.0, +1.0);
+  glTexCoord2f(0.0, 1.0); glVertex2f(-1.0, +1.0);
+  glEnd(); // GL_QUADS
+  glDisable(GL_TEXTURE_2D);
+} // draw
+
+void Canvas::rasterize(unsigned char* image, int w, int h) {
+  // sample the cells (nearest) into a w x h RGB image (top row first)
+  for (int r = 0; r < h; r++) {
+    int j = std::min((h-1-r) * Ny / h, Ny-1);
+    for (int s = 0; s < w; s++) {
+      int i = std::min(s * Nx / w, Nx-1);
+      const float* c = colors + 3*(Nx*j+i);
+      unsigned char* p = image + 3*((size_t)w*r+s);
+      for (int k = 0; k < 3; k++) {
+	p[k] = (unsigned char)(255.0 * std::min(std::max(c[k], 0.0f), 1.0f) + 0.5);
+      }
+    }
+  }
+} // rasterize
@@ -0,0 +1,68 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+// include glut.h with cross-platform support
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+// include standard C/C++ libraries
+#include <cmath>     // abs
+
+// A grid of colored cells, drawn as a texture (one texel per cell) on a
+// quad spanning [-1,+1]x[-1,+1].
+//
+// Changes are tracked per tile of T x T cells: painting a cell marks its
+// tile as dirty, and so does refreshing a cell with a color that differs
+// from the displayed one by more than a threshold (by default, half of an
+// 8-bit color level). Only the dirty tiles are uploaded, as one rectangle
+// per run of dirty tiles along a row of tiles. The texture is created at
+// the first upload, so that a canvas may be set up before the GL context.
+//
+// Without a GL context (e.g. for headless capture), the cells can also be
+// rasterized on the CPU into an RGB image.
+class Canvas {
+public :
+
+  enum { T = 16 }; // Tile size (in cells)
+
+  int Nx, Ny;      // Number of cells in the x- and y-directions
+  int Tx, Ty;      // Number of tiles in the x- and y-directions
+  float threshold; // Smallest color change that is displayed
+  float* colors;   // Displayed cell colors [3*Nx*Ny]
+  bool* dirty;     // Tiles to upload [Tx*Ty]
+  GLuint texture;  // Cell colors, on the GPU (0 until the first upload)
+
+  Canvas();
+  ~Canvas();
+
+  void initialize(int nx, int ny);
+
+  void paint(int i, int j, float r, float g, float b) {
+    // set the color of cell (i,j), and mark its tile
+    float* c = colors + 3*(Nx*j+i);
+    c[0] = r;
+    c[1] = g;
+    c[2] = b;
+    dirty[Tx*(j/T)+i/T] = true;
+  } // paint
+
+  bool refresh(int i, int j, float r, float g, float b) {
+    // set the color of cell (i,j) if it changed visibly, and mark its tile
+    float* c = colors + 3*(Nx*j+i);
+    if ((std::abs(c[0]-r) <= threshold) &&
+	(std::abs(c[1]-g) <= threshold) &&
+	(std::abs(c[2]-b) <= threshold)) return false;
+    paint(i, j, r, g, b);
+    return true;
+  } // refresh
+
+  bool changed(void);
+  int upload(void);
+  void draw(void);
+  void rasterize(unsigned char* image, int w, int h);
+};
+
+#endif // CANVAS_H
@@ -0,0 +1,16 @@
+# Build settings shared by the core library and the apps, which set CORE
+# (the path of the core directory) before including this file, and
+# -include $(DEPS) at the end of their Makefile (after their first rule).
+# The compiler writes the headers of each object to a .d file next to it,
+# so that an object is rebuilt when any of its headers change
+CC=g++
+CF=-Wall -O3 -MMD -MP -I$(CORE)
+INCLUDES=-L/usr/lib/x86_64-linux-gnu/
+
+SRCS=$(shell find . -name '*.cpp')
+OBJS=$(SRCS:.cpp=.o)
+DEPS=$(OBJS:.o=.d)
+
+# Sources of the core library: the library is updated (and the apps
+# linked again) when any of them change
+CORE_SRCS=$(wildcard $(CORE)/*.cpp $(CORE)/*.h)
@@ -0,0 +1,44 @@
+#ifndef DENORMALS_H
+#define DENORMALS_H
+
+// include SSE control registers
+#ifdef __SSE__
+#include <xmmintrin.h> // _mm_getcsr, _mm_setcsr, _MM_SET_FLUSH_ZERO_MODE
+#include <pmmintrin.h> // _MM_SET_DENORMALS_ZERO_MODE
+#endif
+
+// A scope in which denormal results are flushed to zero, and denormal
+// operands are read as zeros: fields that decay geometrically (velocities in
+// the quiet corners of a cavity, Gray-Scott fields away from the patterns)
+// reach denormals, which cost ~100 cycles per operation.
+//
+// The control register is per thread: the mode applies to the calling
+// thread, and to the threads it starts within the scope (which inherit the
+// register). The previous mode is restored when the scope ends. On targets
+// without SSE, the guard does nothing.
+class FlushDenormals {
+public :
+
+  FlushDenormals() {
+#ifdef __SSE__
+    csr = _mm_getcsr();
+    _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+    _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+#endif
+  } // FlushDenormals
+
+  ~FlushDenormals() {
+#ifdef __SSE__
+    _mm_setcsr(csr);
+#endif
+  } // ~FlushDenormals
+
+private :
+
+  FlushDenormals(const FlushDenormals&);
+  FlushDenormals& operator=(const FlushDenormals&);
+
+  unsigned int csr; // Saved control register
+};
+
+#endif // DENORMALS_H
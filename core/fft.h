@@ -0,0 +1,168 @@
+#ifndef FFT_H
+#define FFT_H
+
+// include standard C/C++ libraries
+#include <cmath>     // cos, sin, atan
+#include <vector>    // vector
+#include <algorithm> // swap
+
+// A planned, in-place complex FFT of a fixed length n, on interleaved
+// (real, imaginary) float pairs.
+//
+// The plan is built once, and reused by every transform: for a power of 2,
+// the bit-reversal permutation and the twiddle factors of every stage of an
+// iterative radix-2 transform (each stage's twiddles stored contiguously);
+// for any other length, Bluestein's algorithm, which evaluates the
+// transform as a convolution with a chirp, through a radix-2 transform of
+// the next power of 2 at least 2n-1 long (the chirp, and the transform of
+// the convolution kernel, are part of the plan).
+//
+// Forward() computes X[k] = sum_j x[j] exp(-2 pi i jk/n), and Inverse() the
+// same sum with exp(+2 pi i jk/n), without the 1/n normalization.
+class Fft {
+public:
+
+  int n; // Length
+
+  Fft(int length) {
+    n = length;
+    inner = NULL;
+    double pi = 4.0 * std::atan(1.0);
+    if ((n & (n-1)) == 0) {
+      // radix-2: bit-reversal permutation, and the twiddles of the stage
+      // of half-length h, exp(-i pi k/h) for k < h, at offset h-1
+      int bits = 0;
+      while ((1 << bits) < n) bits++;
+      rev.resize(n);
+      for (int i = 0; i < n; i++) {
+	int r = 0;
+	for (int b = 0; b < bits; b++) {
+	  r |= ((i >> b) & 1) << (bits-1-b);
+	}
+	rev[i] = r;
+      }
+      twiddles.resize(2*std::max(n-1, 1));
+      for (int h = 1; h < n; h *= 2) {
+	for (int k = 0; k < h; k++) {
+	  twiddles[2*(h-1+k)]   = std::cos(pi*k/h);
+	  twiddles[2*(h-1+k)+1] = -std::sin(pi*k/h);
+	}
+      }
+    } else {
+      // Bluestein: chirp c[k] = exp(-i pi k^2/n), and the transform of the
+      // (wrapped) kernel conj(c), scaled by 1/m for the inverse transform
+      int m = 1;
+      while (m < 2*n-1) m *= 2;
+      inner = new Fft(m);
+      chirp.resize(2*n);
+      for (long k = 0; k < n; k++) {
+	double a = pi * double((k*k) % (2*n)) / n;
+	chirp[2*k]   = std::cos(a);
+	chirp[2*k+1] = -std::sin(a);
+      }
+      kernel.assign(2*m, 0.0);
+      for (int k = 0; k < n; k++) {
+	kernel[2*k]   = chirp[2*k] / m;
+	kernel[2*k+1] = -chirp[2*k+1] / m;
+	if (k > 0) {
+	  kernel[2*(m-k)]   = kernel[2*k];
+	  kernel[2*(m-k)+1] = kernel[2*k+1];
+	}
+      }
+      inner->Forward(kernel.data());
+      work.resize(2*m);
+    }
+  } // Fft
+
+  ~Fft() {
+    delete inner;
+  } // ~Fft
+
+  void Forward(float* x) {
+    if (inner == NULL) {
+      Radix2(x, false);
+    } else {
+      Bluestein(x);
+    }
+  } // Forward
+
+  void Inverse(float* x) {
+    if (inner == NULL) {
+      Radix2(x, true);
+    } else {
+      // conj(F(conj(x)))
+      for (int k = 0; k < n; k++) x[2*k+1] = -x[2*k+1];
+      Bluestein(x);
+      for (int k = 0; k < n; k++) x[2*k+1] = -x[2*k+1];
+    }
+  } // Inverse
+
+private:
+
+  Fft(const Fft&);            // not copyable
+  Fft& operator=(const Fft&);
+
+  // radix-2 plan
+  std::vector<int> rev;        // Bit-reversal permutation [n]
+  std::vector<float> twiddles; // Twiddles of all stages [2*(n-1)]
+
+  // Bluestein plan
+  Fft* inner;                  // Radix-2 transform of length m
+  std::vector<float> chirp;    // Chirp [2*n]
+  std::vector<float> kernel;   // Transformed kernel, scaled by 1/m [2*m]
+  std::vector<float> work;     // Convolution workspace [2*m]
+
+  void Radix2(float* x, bool inverse) {
+    // iterative decimation in time: permute, then combine pairs of
+    // transforms of half-length h
+    for (int i = 0; i < n; i++) {
+      int j = rev[i];
+      if (i < j) {
+	std::swap(x[2*i], x[2*j]);
+	std::swap(x[2*i+1], x[2*j+1]);
+      }
+    }
+    const float sign = inverse ? -1.0f : 1.0f;
+    for (int h = 1; h < n; h *= 2) {
+      const float* w = twiddles.data() + 2*(h-1);
+      for (int s = 0; s < n; s += 2*h) {
+	float* __restrict a = x + 2*s;
+	float* __restrict b = x + 2*(s+h);
+	for (int k = 0; k < h; k++) {
+	  float wr = w[2*k], wi = sign*w[2*k+1];
+	  float br = b[2*k]*wr - b[2*k+1]*wi;
+	  float bi = b[2*k]*wi + b[2*k+1]*wr;
+	  b[2*k]   = a[2*k] - br;
+	  b[2*k+1] = a[2*k+1] - bi;
+	  a[2*k]   += br;
+	  a[2*k+1] += bi;
+	}
+      }
+    }
+  } // Radix2
+
+  void Bluestein(float* x) {
+    // X[k] = c[k] sum_j (x[j] c[j]) conj(c[k-j])
+    const int m = inner->n;
+    for (int k = 0; k < n; k++) {
+      work[2*k]   = x[2*k]*chirp[2*k]   - x[2*k+1]*chirp[2*k+1];
+      work[2*k+1] = x[2*k]*chirp[2*k+1] + x[2*k+1]*chirp[2*k];
+    }
+    std::fill(work.begin() + 2*n, work.end(), 0.0f);
+    inner->Forward(work.data());
+    for (int k = 0; k < m; k++) {
+      float r = work[2*k]*kernel[2*k]   - work[2*k+1]*kernel[2*k+1];
+      float i = work[2*k]*kernel[2*k+1] + work[2*k+1]*kernel[2*k];
+      work[2*k]   = r;
+      work[2*k+1] = i;
+    }
+    inner->Inverse(work.data());
+    for (int k = 0; k < n; k++) {
+      x[2*k]   = work[2*k]*chirp[2*k]   - work[2*k+1]*chirp[2*k+1];
+      x[2*k+1] = work[2*k]*chirp[2*k+1] + work[2*k+1]*chirp[2*k];
+    }
+  } // Bluestein
+
+};
+
+#endif // FFT_H
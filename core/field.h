@@ -0,0 +1,216 @@
+#ifndef FIELD_H
+#define FIELD_H
+
+// include standard C/C++ libraries
+#include <iostream> // cerr
+#include <cstdio>   // FILE, fopen, fprintf
+#include <cstring>  // memcpy, strncmp
+#include <cstdlib>  // atoi
+#include <string>   // string
+#include <stdint.h> // uint16_t
+
+// include POSIX headers for memory-mapped file access
+#include <fcntl.h>    // open
+#include <unistd.h>   // close
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+
+// A multi-channel grid of samples, memory-mapped from a raw or NPY file.
+// Channel 0 initializes the pressure head, channels 1 and 2 (if present)
+// initialize the x- and y-velocities, and channel 3 (if present) marks
+// solid elements.
+//
+// Supported files:
+//  -NPY (.npy) with dtype '<f4' or '<u2', and shape (H,W), (H,W,C) or
+//   (C,H,W); a 3D shape is treated as planar (C,H,W) if its first extent is
+//   at most 4 and its last extent is not
+//  -raw float32 or uint16 samples (any other extension), whose dimensions
+//   must be provided by the caller
+//
+// uint16 samples are normalized by 65536 (cf. 8-bit images by 256).
+class Field {
+public:
+
+  enum Type { FLOAT32, UINT16 };
+
+  // Dimensions
+  int width, height; // Number of samples in the x- and y-directions
+  int channels;      // Number of channels per sample
+  Type type;         // Sample type
+  bool planar;       // Channel-major (C,H,W) layout, otherwise (H,W,C)
+
+  // Mapped file
+  char* data;  // First sample
+  void* map;   // Start of the mapping
+  size_t size; // Length of the mapping
+
+  Field(const char* filename) {
+    Open(filename);
+    if (!ParseNpy()) {
+      std::cerr << "Field: " << filename << " is not a supported NPY file" << std::endl;
+      exit(1);
+    }
+  } // Field
+
+  Field(const char* filename, int w, int h, int c, Type t) {
+    Open(filename);
+    width = w;
+    height = h;
+    channels = c;
+    type = t;
+    planar = true;
+    data = (char*)map;
+    if (size < (size_t)w*h*c*SampleSize()) {
+      std::cerr << "Field: " << filename << " is too small" << std::endl;
+      exit(1);
+    }
+  } // Field
+
+  ~Field() {
+    munmap(map, size);
+  } // ~Field
+
+  float operator()(int i, int j, int c) const {
+    // Sample (i,j) of channel c, with j increasing with the row index
+    size_t k = planar ? ((size_t)width*height*c + (size_t)width*j + i)
+                      : (((size_t)width*j + i)*channels + c);
+    if (type == FLOAT32) {
+      float x;
+      memcpy(&x, data + 4*k, 4);
+      return x;
+    } else {
+      uint16_t x;
+      memcpy(&x, data + 2*k, 2);
+      return x/65536.0;
+    }
+  } // operator()
+
+  float* Channel(int c) const {
+    // Direct (zero-copy) pointer to channel c, or NULL if its samples are
+    // not stored as contiguous, aligned float32 values
+    if ((type != FLOAT32) || (!planar && (channels > 1))) return NULL;
+    char* x = data + 4*(size_t)width*height*c;
+    if (((size_t)x) % sizeof(float) != 0) return NULL;
+    return (float*)x;
+  } // Channel
+
+  static bool Exists(const char* filename) {
+    struct stat s;
+    return (stat(filename, &s) == 0);
+  } // Exists
+
+  static bool SaveNpy(const char* filename, const float* x, int w, int h) {
+    // Write a (H,W) float32 NPY file, with a 64-byte aligned data section
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) return false;
+    std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': ("
+                       + std::to_string(h) + ", " + std::to_string(w) + "), }";
+    while ((10 + header.size() + 1) % 64 != 0) header += ' ';
+    header += '\n';
+    unsigned short length = header.size();
+    fwrite("\x93NUMPY\x01\x00", 1, 8, file);
+    fputc(length & 0xff, file);
+    fputc(length >> 8, file);
+    fwrite(header.data(), 1, header.size(), file);
+    fwrite(x, sizeof(float), (size_t)w*h, file);
+    return (fclose(file) == 0);
+  } // SaveNpy
+
+  static bool SavePpm(const char* filename, const unsigned char* image, int w, int h) {
+    // Write a binary (P6) PPM file of w x h RGB pixels, top row first
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) return false;
+    fprintf(file, "P6\n%d %d\n255\n", w, h);
+    fwrite(image, 1, (size_t)w*h*3, file);
+    return (fclose(file) == 0);
+  } // SavePpm
+
+private:
+
+  void Open(const char* filename) {
+    // Map the file privately: writes through a zero-copy channel pointer
+    // become copy-on-write, and never reach the file
+    int fd = open(filename, O_RDONLY);
+    struct stat s;
+    if ((fd < 0) || (fstat(fd, &s) != 0)) {
+      std::cerr << "Field: cannot open " << filename << std::endl;
+      exit(1);
+    }
+    size = s.st_size;
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+      std::cerr << "Field: cannot map " << filename << std::endl;
+      exit(1);
+    }
+  } // Open
+
+  int SampleSize(void) const {
+    return (type == FLOAT32) ? 4 : 2;
+  } // SampleSize
+
+  bool ParseNpy(void) {
+    // Parse the magic string, version, and the header dictionary
+    const char* file = (const char*)map;
+    if ((size < 10) || (strncmp(file, "\x93NUMPY", 6) != 0)) return false;
+    size_t length, offset;
+    if (file[6] == 1) {
+      length = (unsigned char)file[8] | ((unsigned char)file[9] << 8);
+      offset = 10;
+    } else {
+      if (size < 12) return false;
+      length = (unsigned char)file[8] | ((unsigned char)file[9] << 8)
+             | ((unsigned char)file[10] << 16) | ((size_t)(unsigned char)file[11] << 24);
+      offset = 12;
+    }
+    if (offset + length > size) return false;
+    std::string header(file + offset, length);
+
+    // sample type
+    if (header.find("'<f4'") != std::string::npos) {
+      type = FLOAT32;
+    } else if (header.find("'<u2'") != std::string::npos) {
+      type = UINT16;
+    } else {
+      return false;
+    }
+    if (header.find("'fortran_order': True") != std::string::npos) return false;
+
+    // shape
+    size_t p = header.find("'shape': (");
+    if (p == std::string::npos) return false;
+    p += 10;
+    int shape[3];
+    int rank = 0;
+    while ((rank < 3) && (p < header.size()) && (header[p] != ')')) {
+      shape[rank++] = atoi(header.c_str() + p);
+      p = header.find_first_of(",)", p);
+      if ((p != std::string::npos) && (header[p] == ',')) p++;
+      while ((p < header.size()) && (header[p] == ' ')) p++;
+    }
+    if (rank == 2) {
+      height = shape[0];
+      width = shape[1];
+      channels = 1;
+      planar = true;
+    } else if ((rank == 3) && (shape[0] <= 4) && (shape[2] > 4)) {
+      channels = shape[0];
+      height = shape[1];
+      width = shape[2];
+      planar = true;
+    } else if (rank == 3) {
+      height = shape[0];
+      width = shape[1];
+      channels = shape[2];
+      planar = false;
+    } else {
+      return false;
+    }
+
+    data = (char*)map + offset + length;
+    return (size >= offset + length + (size_t)width*height*channels*SampleSize());
+  } // ParseNpy
+
+};
+
+#endif // FIELD_H
@@ -0,0 +1,78 @@
+#ifndef HASH_H
+#define HASH_H
+
+// include standard C/C++ libraries
+#include <cstdint>   // uint64_t
+#include <cstring>   // memcpy
+#include <cstddef>   // size_t
+
+// XXH64, a fast non-cryptographic 64-bit hash, used to fingerprint fields
+// (their exact bits) so that two runs, or two implementations of a kernel,
+// can be checked to produce identical results.
+//
+// The input is consumed in 32-byte stripes by 4 independent accumulators
+// (so that the multiplications overlap), which are then merged with the
+// length and the tail of the input, and mixed by a final avalanche. Several
+// arrays may be chained by passing the hash of one as the seed of the next.
+// Words are read little-endian (the byte order of every supported host).
+inline uint64_t Hash64(const void* data, size_t bytes, uint64_t seed = 0) {
+  const uint64_t P1 = 0x9E3779B185EBCA87ULL;
+  const uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+  const uint64_t P3 = 0x165667B19E3779F9ULL;
+  const uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+  const uint64_t P5 = 0x27D4EB2F165667C5ULL;
+  struct Mix {
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t round(uint64_t acc, uint64_t x) {
+      return rotl(acc + x * P2, 31) * P1;
+    }
+    static uint64_t merge(uint64_t h, uint64_t acc) {
+      return (h ^ round(0, acc)) * P1 + P4;
+    }
+    static uint64_t read64(const unsigned char* p) { uint64_t x; memcpy(&x, p, 8); return x; }
+    static uint64_t read32(const unsigned char* p) { uint32_t x; memcpy(&x, p, 4); return x; }
+  };
+
+  const unsigned char* p = (const unsigned char*)data;
+  const unsigned char* end = p + bytes;
+  uint64_t h;
+  if (bytes >= 32) {
+    uint64_t a = seed + P1 + P2, b = seed + P2, c = seed, d = seed - P1;
+    for (; p + 32 <= end; p += 32) {
+      a = Mix::round(a, Mix::read64(p));
+      b = Mix::round(b, Mix::read64(p + 8));
+      c = Mix::round(c, Mix::read64(p + 16));
+      d = Mix::round(d, Mix::read64(p + 24));
+    }
+    h = Mix::rotl(a, 1) + Mix::rotl(b, 7) + Mix::rotl(c, 12) + Mix::rotl(d, 18);
+    h = Mix::merge(h, a);
+    h = Mix::merge(h, b);
+    h = Mix::merge(h, c);
+    h = Mix::merge(h, d);
+  } else {
+    h = seed + P5;
+  }
+  h += bytes;
+
+  // the tail: 8, then 4 bytes, then single bytes at a time
+  for (; p + 8 <= end; p += 8) {
+    h = Mix::rotl(h ^ Mix::round(0, Mix::read64(p)), 27) * P1 + P4;
+  }
+  if (p + 4 <= end) {
+    h = Mix::rotl(h ^ (Mix::read32(p) * P1), 23) * P2 + P3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    h = Mix::rotl(h ^ (*p * P5), 11) * P1;
+  }
+
+  // avalanche
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+  return h;
+} // Hash64
+
+#endif // HASH_H
@@ -0,0 +1,154 @@
+#ifndef POOL_H
+#define POOL_H
+
+// include standard C/C++ libraries
+#include <vector>             // vector
+#include <deque>              // deque
+#include <thread>             // thread, hardware_concurrency
+#include <mutex>              // mutex, lock_guard, unique_lock
+#include <condition_variable> // condition_variable
+#include <functional>         // function
+#include <algorithm>          // max
+
+// include SSE control registers
+#ifdef __SSE__
+#include <xmmintrin.h> // _mm_getcsr, _mm_setcsr
+#endif
+
+// A persistent pool of worker threads, which run the tasks of a kernel
+// (numbered from 0) with the calling thread, and sleep between kernels: the
+// threads are started once, rather than with every kernel of every step.
+//
+// The tasks are dealt round-robin to one queue per thread (so that task t
+// of consecutive kernels runs on the same thread, and finds its slab of the
+// arrays in its cache); a thread takes its own tasks first, then steals the
+// oldest task of another queue (cf. Ensemble). Run returns when every task
+// is done. The workers take the control register (denormal flushing, cf.
+// FlushDenormals) of the caller for each kernel, as threads started by the
+// caller would.
+class Pool {
+public:
+
+  Pool(int threads = 0) : size(std::max(1, threads > 0 ? threads : int(std::thread::hardware_concurrency()))),
+                          queues(size), generation(0), finished(0), stop(false), task(NULL) {
+    for (int t = 1; t < size; t++) {
+      workers.push_back(std::thread(&Pool::Loop, this, t));
+    }
+  } // Pool
+
+  ~Pool() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stop = true;
+    }
+    wake.notify_all();
+    for (size_t t = 0; t < workers.size(); t++) {
+      workers[t].join();
+    }
+  } // ~Pool
+
+  int Size(void) const {
+    return size;
+  } // Size
+
+  void Run(int n, const std::function<void(int)>& kernel) {
+    // Run kernel(0), ..., kernel(n-1) on the threads of the pool, and wait
+    // for them
+    if ((size == 1) || (n <= 1)) {
+      for (int i = 0; i < n; i++) {
+	kernel(i);
+      }
+      return;
+    }
+    for (int i = 0; i < n; i++) {
+      queues[i % size].tasks.push_back(i);
+    }
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      task = &kernel;
+#ifdef __SSE__
+      csr = _mm_getcsr();
+#endif
+      finished = 0;
+      generation++;
+    }
+    wake.notify_all();
+    Work(0);
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this] { return finished == size - 1; });
+    task = NULL;
+  } // Run
+
+private:
+
+  struct Queue {
+    std::mutex lock;
+    std::deque<int> tasks; // Indices of the tasks
+  };
+
+  int size;                          // Number of threads, with the caller
+  std::vector<Queue> queues;         // Tasks, one queue per thread
+  std::vector<std::thread> workers;  // Threads 1 to size-1
+  std::mutex lock;                   // Guards the fields below
+  std::condition_variable wake;      // A kernel is started, or the pool stopped
+  std::condition_variable done;      // Every worker is done with the kernel
+  long generation;                   // Number of kernels started
+  int finished;                      // Workers done with the current kernel
+  bool stop;                         // The pool is destroyed
+  const std::function<void(int)>* task; // Current kernel
+  unsigned int csr;                  // Control register of the caller
+
+  Pool(const Pool&);
+  Pool& operator=(const Pool&);
+
+  void Loop(int t) {
+    // Wait for a kernel, run its tasks, and report
+    long seen = 0;
+    while (true) {
+      {
+	std::unique_lock<std::mutex> guard(lock);
+	wake.wait(guard, [&] { return stop || (generation != seen); });
+	if (stop) return;
+	seen = generation;
+#ifdef __SSE__
+	_mm_setcsr(csr);
+#endif
+      }
+      Work(t);
+      {
+	std::lock_guard<std::mutex> guard(lock);
+	finished++;
+      }
+      done.notify_one();
+    }
+  } // Loop
+
+  void Work(int t) {
+    // Run tasks (from the back of the own queue, or else from the front of
+    // another queue) until every queue is empty; tasks are never queued
+    // again, so that an empty pool means the work is handed out
+    while (true) {
+      int i = -1;
+      {
+	std::lock_guard<std::mutex> guard(queues[t].lock);
+	if (!queues[t].tasks.empty()) {
+	  i = queues[t].tasks.back();
+	  queues[t].tasks.pop_back();
+	}
+      }
+      for (int v = 1; (i < 0) && (v < size); v++) {
+	Queue& victim = queues[(t+v) % size];
+	std::lock_guard<std::mutex> guard(victim.lock);
+	if (!victim.tasks.empty()) {
+	  i = victim.tasks.front();
+	  victim.tasks.pop_front();
+	}
+      }
+      if (i < 0) return;
+      (*task)(i);
+    }
+  } // Work
+
+};
+
+#endif // POOL_H
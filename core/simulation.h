@@ -0,0 +1,40 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+// include standard C/C++ libraries
+#include <stdint.h> // uint64_t
+
+// A simulation, as driven by the front end (App): it is advanced in time,
+// drawn into the current GL context, or rasterized into an RGB image when
+// running without a display. Pointer positions are given in window
+// coordinates spanning [-1,+1]x[-1,+1], with y pointing up.
+class Simulation {
+public :
+
+  virtual ~Simulation() {}
+
+  // advance the state by dt seconds
+  virtual void step(float dt) = 0;
+
+  // update the displayed state, returning whether it needs redrawing
+  virtual bool refresh(void) { return true; }
+
+  // draw the displayed state (requires a current GL context)
+  virtual void render(void) = 0;
+
+  // draw the displayed state into a w x h RGB image (top row first),
+  // returning false if headless rendering is not supported
+  virtual bool rasterize(unsigned char* image, int w, int h) { return false; }
+
+  // fingerprint the state (its exact bits) into h, returning false if
+  // hashing is not supported
+  virtual bool hash(uint64_t* h) { return false; }
+
+  // respond to a key press (the escape key is handled by the front end)
+  virtual void keyboard(unsigned char c) {}
+
+  // respond to a press (start) or drag of the left mouse button at (x,y)
+  virtual void pointer(float x, float y, bool start) {}
+};
+
+#endif // SIMULATION_H
@@ -0,0 +1,120 @@
+#ifndef SPECTRAL_H
+#define SPECTRAL_H
+
+// include project headers
+#include "fft.h"     // Fft
+
+// include standard C/C++ libraries
+#include <cmath>     // exp, atan
+#include <vector>    // vector
+#include <algorithm> // min
+
+// The exact solution operator of the diffusion equation u' = k Lu on a
+// periodic grid of Nx x Ny samples (spacings hx, hy): each Fourier mode is
+// damped by exp(-k |xi|^2 dt), so that a step of any length is stable.
+//
+// The field is transformed along its rows, transposed (in cache blocks),
+// and transformed along its columns, so that every transform runs on
+// contiguous samples; the damping is applied in the transposed layout, and
+// the way back mirrors the way in. The damping is real and even in xi, so
+// that two real fields are filtered at the cost of one, as the real and
+// imaginary parts of a complex field. The row and column plans, and the
+// damping factors of the last k dt (normalization included), are cached.
+class SpectralDiffusion {
+public:
+
+  int Nx, Ny;     // Number of samples in the x- and y-directions
+  float hx, hy;   // Sample spacings
+
+  SpectralDiffusion(int nx, int ny, float sx, float sy) : rows(nx), cols(ny) {
+    Nx = nx;
+    Ny = ny;
+    hx = sx;
+    hy = sy;
+    a.resize(2*Nx*Ny);
+    t.resize(2*Nx*Ny);
+    factor.resize(Nx*Ny);
+    kdt = -1.0; // no cached factors
+  } // SpectralDiffusion
+
+  void Apply(float* x, int stride, float k_dt) {
+    // Diffuse the samples x[stride*j+i], for i < Nx and j < Ny, over k dt
+    Apply(x, NULL, stride, k_dt);
+  } // Apply
+
+  void Apply(float* x, float* y, int stride, float k_dt) {
+    // Diffuse two fields (or one, if y is NULL) over k dt
+    for (int j = 0; j < Ny; j++) {
+      float* r = a.data() + 2*Nx*j;
+      for (int i = 0; i < Nx; i++) {
+	r[2*i]   = x[stride*j+i];
+	r[2*i+1] = (y != NULL) ? y[stride*j+i] : 0.0f;
+      }
+      rows.Forward(r);
+    }
+    Transpose(a.data(), t.data(), Nx, Ny);
+    Factors(k_dt);
+    for (int i = 0; i < Nx; i++) {
+      float* c = t.data() + 2*Ny*i;
+      const float* f = factor.data() + Ny*i;
+      cols.Forward(c);
+      for (int j = 0; j < Ny; j++) {
+	c[2*j]   *= f[j];
+	c[2*j+1] *= f[j];
+      }
+      cols.Inverse(c);
+    }
+    Transpose(t.data(), a.data(), Ny, Nx);
+    for (int j = 0; j < Ny; j++) {
+      float* r = a.data() + 2*Nx*j;
+      rows.Inverse(r);
+      for (int i = 0; i < Nx; i++) {
+	x[stride*j+i] = r[2*i];
+	if (y != NULL) y[stride*j+i] = r[2*i+1];
+      }
+    }
+  } // Apply
+
+private:
+
+  Fft rows, cols;            // Row (Nx) and column (Ny) plans
+  std::vector<float> a;      // Row-major workspace [2*Nx*Ny]
+  std::vector<float> t;      // Column-major workspace [2*Nx*Ny]
+  std::vector<float> factor; // Damping factors, column-major [Nx*Ny]
+  float kdt;                 // k dt of the cached factors
+
+  void Factors(float k_dt) {
+    // Damping factors exp(-k dt |xi|^2) / (Nx Ny), with the wave numbers of
+    // the periodic grid (the upper half of each transform holds the
+    // negative ones)
+    if (k_dt == kdt) return;
+    kdt = k_dt;
+    double pi = 4.0 * std::atan(1.0);
+    for (int i = 0; i < Nx; i++) {
+      double xi = 2.0*pi * ((2*i <= Nx) ? i : i - Nx) / (Nx*hx);
+      for (int j = 0; j < Ny; j++) {
+	double eta = 2.0*pi * ((2*j <= Ny) ? j : j - Ny) / (Ny*hy);
+	factor[Ny*i+j] = std::exp(-kdt*(xi*xi + eta*eta)) / (double(Nx)*Ny);
+      }
+    }
+  } // Factors
+
+  static void Transpose(const float* src, float* dst, int nx, int ny) {
+    // transpose src (ny rows of nx complex pairs) into dst (nx rows of ny
+    // pairs), in 16 x 16 blocks
+    const int B = 16;
+    for (int j0 = 0; j0 < ny; j0 += B) {
+      for (int i0 = 0; i0 < nx; i0 += B) {
+	for (int j = j0; j < std::min(j0+B, ny); j++) {
+	  for (int i = i0; i < std::min(i0+B, nx); i++) {
+	    dst[2*(ny*i+j)]   = src[2*(nx*j+i)];
+	    dst[2*(ny*i+j)+1] = src[2*(nx*j+i)+1];
+	  }
+	}
+      }
+    }
+  } // Transpose
+
+};
+
+#endif // SPECTRAL_H
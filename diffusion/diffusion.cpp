@@ -5,112 +5,121 @@
 #include <GL/glut.h>
 #endif
 
+// include project headers
+#include "app.h"      // App
+#include "canvas.h"   // Canvas
+#include "field.h"    // Field
+#include "reaction.h" // Reaction
+#include "spectral.h" // SpectralDiffusion
+
 // include standard C/C++ libraries
-#include<iostream>  // exit
-#include<cmath>     // abs
-#include<unistd.h>  // usleep
+#include<iostream>  // cout, cerr
+#include<cmath>     // floor
+#include<cstdlib>   // rand
+#include<cstring>   // strcmp
+#include<algorithm> // min, max
 
 // include CImg for reading image files
 #include "CImg.h"
 using namespace cimg_library;
 
-// forward declarations
-void motion(int x, int y);
-
-class Pixel {
+class Grid : public Simulation {
 private :
-  float coordinate[2];
-  float dimension[2];
-  float color[3];
-  
-public :
-
-  void setCoordinate(float x, float y) {
-    coordinate[0] = x;
-    coordinate[1] = y;
-  }
-   
-  void setDimension(float w, float h) {
-    dimension[0] = w;
-    dimension[1] = h;
-  }
-
-  void setColor(float r, float g, float b) {
-    color[0] = r;
-    color[1] = g;
-    color[2] = b;
-  }
-
-  float value(void) {
-    return color[0];
-  }
+  int Nx, Ny;
+  float* u;      // Concentrations [Nx*Ny]
+  Canvas canvas; // Displayed concentrations
+  float time;
+  float diffusivity;
 
-  void addValue(float c) {
-    color[0] += c;
-    color[1] += c;
-    color[2] += c;
-  }
+  // Exact diffusion on a periodic domain (NULL for the explicit stencil)
+  SpectralDiffusion* spectral;
 
-  void render(void) {
-    // vertices are draw in normalized device coordinates (NDC)
-    glColor3f(color[0], color[1], color[2]); // color vertex 1
-    glVertex2f(coordinate[0]-0.5*dimension[0],coordinate[1]-0.5*dimension[1]);
+  // Reaction-diffusion mode (NULL for pure diffusion)
+  Reaction* reaction;
+  int iterations; // Reaction steps per update
 
-    glColor3f(color[0], color[1], color[2]); // color vertex 2
-    glVertex2f(coordinate[0]+0.5*dimension[0],coordinate[1]-0.5*dimension[1]);
+public :
 
-    glColor3f(color[0], color[1], color[2]); // color vertex 3
-    glVertex2f(coordinate[0]+0.5*dimension[0],coordinate[1]+0.5*dimension[1]);
+  template<class Source>
+  void initialize(int nx, int ny, Source& source, float scale) {
+    // initialize the concentrations from channel 0 of an image or field
+    time = 0.0;
+    diffusivity = 0.0003; // default initialization
+    spectral = NULL;
+    reaction = NULL;
+    iterations = 1000;
+    Nx = nx;
+    Ny = ny;
+    u = new float[Nx*Ny];
+    canvas.initialize(Nx, Ny);
+    for (int j = 0; j < Ny; j++) {
+      for (int i = 0; i < Nx; i++) {
+	u[i+Nx*j] = scale*source(i,j,0);
+	canvas.paint(i, j, u[i+Nx*j], u[i+Nx*j], u[i+Nx*j]);
+      }
+    }
+  } // initialize
 
-    glColor3f(color[0], color[1], color[2]); // color vertex 4
-    glVertex2f(coordinate[0]-0.5*dimension[0],coordinate[1]+0.5*dimension[1]);
+  int width(void) {
+    return 12*Nx;
   }
-};
 
-class Grid {
-private :
-  int Nx, Ny, Px, Py;
-  Pixel* pixels;
-  float time;
+  int height(void) {
+    return 12*Ny;
+  }
 
-public :
+  const float* values(void) {
+    return u;
+  }
 
-  void initialize(CImg<float>& image) {
-    time = 0.0;
-    std::cout << image.spectrum() << std::endl;
-    Nx = image.width();
-    Ny = image.height();
-    Px = 12*Nx;
-    Py = 12*Ny;
-    float w = 2.0 / Nx;
-    float h = 2.0 / Ny;
-    pixels = new Pixel[Nx*Ny];
+  void react(Reaction::Model model) {
+    // start a reaction from the current concentrations: Gray-Scott seeds
+    // where they exceed one half, FitzHugh-Nagumo excitations scaled from
+    // them, with some noise in both cases
+    delete reaction;
+    reaction = new Reaction(Nx, Ny, model);
     for (int j = 0; j < Ny; j++) {
-      float y = h * (j + 0.5) - 1.0;
       for (int i = 0; i < Nx; i++) {
-	float x = w * (i + 0.5) - 1.0;
-	pixels[i+Nx*j].setCoordinate(x, y);
-	pixels[i+Nx*j].setDimension(w, h);
-	pixels[i+Nx*j].setColor(image(i,j,0)/256.0,
-                                image(i,j,0)/256.0,
-                                image(i,j,0)/256.0);
+	float noise = float(rand()) / RAND_MAX;
+	if (model == Reaction::GRAY_SCOTT) {
+	  if (u[i+Nx*j] > 0.5) {
+	    reaction->U(i,j) = 0.5;
+	    reaction->V(i,j) = 0.25;
+	  }
+	  reaction->V(i,j) += 0.01*noise;
+	} else {
+	  reaction->U(i,j) = u[i+Nx*j] + noise - 1.0;
+	  reaction->V(i,j) = 0.0;
+	}
       }
     }
-  } // initialize
-
-  float getTime(void) {
-    return time;
   }
 
-  void setTime(float t) {
-    time = t;
+  void report(void) {
+    std::cout << ((reaction->model == Reaction::GRAY_SCOTT) ? "Gray-Scott" : "FitzHugh-Nagumo")
+	      << ": " << iterations << " steps per update, " << reaction->Rate() << " steps/s, "
+	      << 1.0e-6 * Nx * Ny * reaction->Rate() << " Mcell-steps/s" << std::endl;
   }
 
-  void update(float dt) {
+  void step(float dt) {
+    // in reaction-diffusion mode, take a fixed number of (fixed) steps
+    if (reaction != NULL) {
+      reaction->Step(iterations);
+      return;
+    }
+
     // compute updating coefficients
     float w = 2.0 / Nx;
     float h = 2.0 / Ny;
-    float k = 0.0003; // diffusivity
+    float k = diffusivity;
+
+    // on a periodic domain, take an exact step in Fourier space
+    if (spectral != NULL) {
+      spectral->Apply(u, Nx, k * dt);
+      time += dt;
+      return;
+    }
+
     float fx = k * dt / (w*w);
     float fy = k * dt / (h*h);
 
@@ -118,38 +127,38 @@ public :
     float du[Nx][Ny];
     for (int j = 0; j < Ny; j++) {
       for (int i = 0; i < Nx; i++) {
-	du[i][j] = -2.0 * (fx + fy) * pixels[i+Nx*j].value();
+	du[i][j] = -2.0 * (fx + fy) * u[i+Nx*j];
       }
     }
 
     for (int j = 0; j < Ny; j++) {
       for (int i = 1; i < Nx; i++) {
-	du[i][j] += fx * pixels[i-1+Nx*j].value();
+	du[i][j] += fx * u[i-1+Nx*j];
       }
     }
 
     for (int j = 0; j < Ny; j++) {
       for (int i = 0; i < (Nx-1); i++) {
-	du[i][j] += fx * pixels[i+1+Nx*j].value();
+	du[i][j] += fx * u[i+1+Nx*j];
       }
     }
 
     for (int j = 1; j < Ny; j++) {
       for (int i = 0; i < Nx; i++) {
-	du[i][j] += fy * pixels[i+Nx*(j-1)].value();
+	du[i][j] += fy * u[i+Nx*(j-1)];
       }
     }
 
     for (int j = 0; j < (Ny-1); j++) {
       for (int i = 0; i < Nx; i++) {
-	du[i][j] += fy * pixels[i+Nx*(j+1)].value();
+	du[i][j] += fy * u[i+Nx*(j+1)];
       }
     }
 
     // update concentrations
     for (int j = 0; j < Ny; j++) {
       for (int i = 0; i < Nx; i++) {
-	pixels[i+Nx*j].addValue(du[i][j]);
+	u[i+Nx*j] += du[i][j];
       }
     }
 
@@ -157,168 +166,106 @@ public :
     time += dt;
   }
 
-  int width(void) {
-    return Px;
-  }
-
-  int height(void) {
-    return Py;
-  }
-
-  void setWidth(int p) {
-    Px = p;
-  }
-
-  void setHeight(int p) {
-    Py = p;
-  }
-
-  void keyboard(unsigned char c, int x, int y) {
-    if (c == 27) { // ASCII code for the escape key
-      exit(0);
+  bool refresh(void) {
+    // update the displayed concentrations (or u, in reaction-diffusion
+    // mode) that changed visibly, returning whether any did
+    bool changed = false;
+    for (int j = 0; j < Ny; j++) {
+      for (int i = 0; i < Nx; i++) {
+	float c = u[i+Nx*j];
+	if (reaction != NULL) {
+	  c = (reaction->model == Reaction::GRAY_SCOTT) ? 1.0 - reaction->U(i,j)
+	                                                : 0.5 + 0.5*reaction->U(i,j);
+	}
+	changed |= canvas.refresh(i, j, c, c, c);
+      }
     }
+    return changed;
   }
 
-  void mouse(int button, int state, int x, int y) {
-    if ((button == GLUT_LEFT_BUTTON) && (state == GLUT_DOWN)) {
-      float w = 2.0 / Nx;
-      float h = 2.0 / Ny;
-      int i = std::min(std::max(int(floor(((2.0 / Px) * x) / w)),0),Nx-1);
-      int j = std::min(std::max(int(floor((2.0 - (2.0 / Py) * y) / h)),0),Ny-1);
-      pixels[i+Nx*j].setColor(1.0,1.0,1.0);
-      glutMotionFunc(motion);
-      glutPostRedisplay(); // refresh the display
+  void keyboard(unsigned char c) {
+    if (c == 'r') { // cycle diffusion / Gray-Scott / FitzHugh-Nagumo
+      if (reaction == NULL) {
+	react(Reaction::GRAY_SCOTT);
+      } else if (reaction->model == Reaction::GRAY_SCOTT) {
+	react(Reaction::FITZHUGH_NAGUMO);
+      } else {
+	delete reaction;
+	reaction = NULL;
+      }
+      std::cout << "reaction: " << ((reaction == NULL) ? "none" : "on") << std::endl;
+    } else if (c == 's') { // toggle exact (spectral) periodic diffusion
+      if (spectral == NULL) {
+	spectral = new SpectralDiffusion(Nx, Ny, 2.0 / Nx, 2.0 / Ny);
+      } else {
+	delete spectral;
+	spectral = NULL;
+      }
+      std::cout << "spectral (periodic) diffusion: " << (spectral != NULL) << std::endl;
+    } else if ((reaction != NULL) && ((c == '+') || (c == '='))) { // more steps per update
+      iterations *= 2;
+      report();
+    } else if ((reaction != NULL) && (c == '-') && (iterations > 1)) { // fewer steps per update
+      iterations /= 2;
+      report();
+    } else if ((reaction != NULL) && (c == 'i')) { // report the throughput
+      report();
     }
   }
 
-  void m_motion(int x, int y) {
-    float w = 2.0 / Nx;
-    float h = 2.0 / Ny;
-    int i = std::min(std::max(int(floor(((2.0 / Px) * x) / w)),0),Nx-1);
-    int j = std::min(std::max(int(floor((2.0 - (2.0 / Py) * y) / h)),0),Ny-1);
-    pixels[i+Nx*j].setColor(1.0,1.0,1.0);
-    glutPostRedisplay(); // refresh the display
+  void pointer(float x, float y, bool start) {
+    int i = std::min(std::max(int(floor(0.5 * (x + 1.0) * Nx)),0),Nx-1);
+    int j = std::min(std::max(int(floor(0.5 * (y + 1.0) * Ny)),0),Ny-1);
+    if (reaction != NULL) { // seed (Gray-Scott) or excite (FitzHugh-Nagumo)
+      reaction->U(i,j) = (reaction->model == Reaction::GRAY_SCOTT) ? 0.5 : 1.0;
+      reaction->V(i,j) = (reaction->model == Reaction::GRAY_SCOTT) ? 0.25 : 0.0;
+      return;
+    }
+    u[i+Nx*j] = 1.0;
+    canvas.paint(i, j, 1.0, 1.0, 1.0);
   }
 
   void render(void) {
-    // clear the current bit buffers, restoring them to their preset values
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // draw quadrilaterals
-    glBegin(GL_QUADS);
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 0; i < Nx; i++) {
-	pixels[i+Nx*j].render();
-      }
-    }
-    glEnd(); // GL_QUADS
-
-    // for double buffering: display buffer that was just rendered
-    glutSwapBuffers();
-
+    // upload the changed tiles, and draw the cells
+    canvas.upload();
+    glColor3f(1.0, 1.0, 1.0);
+    canvas.draw();
   } // render
-};
-
-// declare global grid instance
-Grid g;
-
-void keyboard(unsigned char c, int x, int y) {
-  g.keyboard(c, x, y);
-}
-
-void mouse(int button, int state, int x, int y) {
-  g.mouse(button, state, x, y);
-}
-
-void motion(int x, int y) {
-  g.m_motion(x, y);
-}
 
-void render(void) {
-  g.render();
-}
+  bool rasterize(unsigned char* image, int w, int h) {
+    canvas.rasterize(image, w, h);
+    return true;
+  } // rasterize
+};
 
-void idle(void) {
-  float t = glutGet(GLUT_ELAPSED_TIME);
-  float dt = (t - g.getTime()) / 1000;
-  g.setTime(t);
-  g.update(dt);
-  glutMouseFunc(mouse);
-  glutPostRedisplay(); // refresh the display
-}
+int main(int argc, char** argv) {
+  // load the initial conditions: use the (memory-mapped) NPY file given on
+  // the command line, or the cached copy of the PNG image (made from the
+  // image when the cache is missing)
+  //  usage: ./diffusion [file.npy] [gray-scott | fitzhugh-nagumo]
+  //  (keys: s toggles exact diffusion on a periodic domain, r cycles
+  //   diffusion / Gray-Scott / FitzHugh-Nagumo, + and - change the number
+  //   of reaction steps per update, i reports steps/s)
+  Grid g;
+  const char* cache = "initial_conditions.npy";
+  const char* filename = (argc > 1) ? argv[1] : cache;
+  if (Field::Exists(filename)) {
+    Field field(filename);
+    g.initialize(field.width, field.height, field, 1.0); // initialize the grid
+  } else if (strcmp(filename, cache) != 0) {
+    std::cerr << "diffusion: cannot open " << filename << std::endl;
+    return 1;
+  } else {
+    CImg<float> image("initial_conditions.png");
+    g.initialize(image.width(), image.height(), image, 1.0/256.0); // initialize the grid
+    Field::SaveNpy(cache, g.values(), image.width(), image.height());
+  }
 
-void reshape(int w, int h) {
-  // Prevent a divide by zero, when window is too short
-  // (you cant make a window of zero width).
-  if (h == 0) {h = 1;}
-  float ratio = (1.0 * w) / h;
-
-  // change pixel dimension of the window
-  g.setWidth(glutGet(GLUT_WINDOW_WIDTH));
-  g.setHeight(glutGet(GLUT_WINDOW_HEIGHT));
-
-  // Use the Projection Matrix
-  glMatrixMode(GL_PROJECTION);
-
-  // Reset Matrix
-  glLoadIdentity();
-
-  // Set the viewport to be the entire window
-  // -1st & 2nd args: (x,y) coordinate of the bottom-left viewport corner
-  // -3rd & 4th args: (x,y) coordinate of the top-right viewport corner
-  glViewport(0, 0, w, h);
-
-  // Set the correct perspective.
-  // -1st arg: field of view angle in yz plane
-  // -2nd arg: (re-)define width-to-height ratio of the viewport
-  // -3rd arg: depth value of near clipping plane
-  // -4th arg: depth value of far clipping plane
-  gluPerspective(0,ratio,0,1000);
-
-  // Get Back to the Modelview
-  // -uses the scaling matrix in other glut functions, as needed
-  glMatrixMode(GL_MODELVIEW);
-}
+  if (argc > 2) {
+    g.react((strcmp(argv[2], "gray-scott") == 0) ? Reaction::GRAY_SCOTT
+                                                 : Reaction::FITZHUGH_NAGUMO);
+  }
 
-int main(int argc, char** argv) {
-  CImg<float> image("elevation.png");
-  g.initialize(image); // initialize the grid
-
-  // initialize glut
-  glutInit(&argc, argv);
-
-  // specify the initial position of the display window
-  //  -default value is (-1,-1), leading to automatic window placement
-  glutInitWindowPosition(100, 100);
-
-  // specify the initial size of the display window (in pixels)
-  glutInitWindowSize(g.width(), g.height());
-
-  // initialize the display modes:
-  // -define colors via RGBA values
-  // -use double buffering (for smoother animations)
-  // -use depth buffering (to correctly occlude objects with greater depth)
-  glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
-
-  // create the display window with the specified name
-  glutCreateWindow("Grid");
-
-  // define call-back functions:
-  // -main display function to run if there is a state change
-  glutDisplayFunc(render);
-  // -function to run in response to window resizing
-  glutReshapeFunc(reshape);
-  // -function to run in response to keyboard input
-  glutKeyboardFunc(keyboard);
-  // -function to run in response to mouse input
-  glutMouseFunc(mouse);
-  // -function to run if no active input is provided
-  glutIdleFunc(idle);
-  
-  // enter main display loop
-  glutMainLoop();
-
-  // the program should never reach this point; return 1 if it does
-  return 1;
+  App app(&g, "Diffusion", "diffusion", g.width(), g.height());
+  return app.run(argc, argv);
 }
-
@@ -0,0 +1,181 @@
+#ifndef REACTION_H
+#define REACTION_H
+
+// include standard C/C++ libraries
+#include <cstring>   // memcpy
+#include <algorithm> // min, max, swap
+#include <chrono>    // steady_clock
+
+// include project headers
+#include "denormals.h" // FlushDenormals
+
+// Two coupled fields (u,v) on a grid of cells, evolving by diffusion and a
+// local reaction, with explicit (forward Euler) steps in cell units:
+//
+//  Gray-Scott:       u' = Du Lu - u v^2 + F (1 - u)
+//                    v' = Dv Lv + u v^2 - (F + k) v
+//  FitzHugh-Nagumo:  u' = Du Lu + u - u^3 - v + kappa
+//                    v' = Dv Lv + (u - v) / tau
+//
+// where L is the 5-point Laplacian, with zero-flux boundaries.
+//
+// The fields are interleaved, as (u,v) pairs, in a grid with a ghost layer
+// of cells: both Laplacians then use the same neighbor offsets (2 floats
+// along x, one row along y), and a single fused pass per step reads every
+// pair once, and computes both Laplacians and the reaction into a second
+// buffer. The ghost layer is filled (by copying the boundary cells) before
+// every pass, so that the pass has no branches, and vectorizes.
+//
+// Gray-Scott fields decay towards zero away from the patterns, into
+// denormal numbers that are an order of magnitude slower to compute with:
+// denormals are flushed to zero while stepping (on SSE targets).
+class Reaction {
+public:
+
+  enum Model { GRAY_SCOTT, FITZHUGH_NAGUMO };
+
+  // Dimensions
+  int Nx, Ny; // Number of cells in the x- and y-directions
+  int W;      // Row length, in floats (including the ghost cells)
+
+  // Parameters
+  Model model;
+  float Du, Dv;     // Diffusivities (cells^2 per unit time)
+  float F, k;       // Gray-Scott feed and kill rates
+  float kappa, tau; // FitzHugh-Nagumo excitation, and recovery time
+  float dt;         // Time step
+
+  // Fields: (u,v) pairs, with a ghost layer [(Nx+2)*(Ny+2)*2]
+  float* a; // Current state
+  float* b; // Next state
+
+  // Cost
+  long steps;     // Number of steps taken
+  double seconds; // Time spent stepping
+
+  Reaction(int nx, int ny, Model m = GRAY_SCOTT) {
+    Nx = nx;
+    Ny = ny;
+    W = 2*(Nx+2);
+    a = new float[W*(Ny+2)];
+    b = new float[W*(Ny+2)];
+    steps = 0;
+    seconds = 0.0;
+    F = k = kappa = 0.0;
+    tau = 1.0;
+    SetModel(m);
+  } // Reaction
+
+  ~Reaction() {
+    delete[] a;
+    delete[] b;
+  } // ~Reaction
+
+  void SetModel(Model m) {
+    // Set the parameters of a model (patterns forming in a few thousand
+    // steps), and its rest state
+    model = m;
+    if (model == GRAY_SCOTT) {
+      Du = 0.2097;
+      Dv = 0.105;
+      F = 0.037;
+      k = 0.06;
+      dt = 1.0;
+      Fill(1.0, 0.0);
+    } else {
+      Du = 0.7;
+      Dv = 125.0;
+      kappa = -0.005;
+      tau = 0.1;
+      dt = 0.001;
+      Fill(0.0, 0.0);
+    }
+  } // SetModel
+
+  float& U(int i, int j) {
+    return a[W*(j+1) + 2*(i+1)];
+  } // U
+
+  float& V(int i, int j) {
+    return a[W*(j+1) + 2*(i+1) + 1];
+  } // V
+
+  void Step(int n) {
+    // Take n steps
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    FlushDenormals flush;
+    for (int s = 0; s < n; s++) {
+      Ghosts();
+      if (model == GRAY_SCOTT) {
+	Update<GRAY_SCOTT>();
+      } else {
+	Update<FITZHUGH_NAGUMO>();
+      }
+      std::swap(a, b);
+    }
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    seconds += std::chrono::duration<double>(stop - start).count();
+    steps += n;
+  } // Step
+
+  double Rate(void) {
+    // Steps per second
+    return (seconds > 0.0) ? steps / seconds : 0.0;
+  } // Rate
+
+private:
+
+  void Fill(float u, float v) {
+    for (int j = 0; j < Ny; j++) {
+      for (int i = 0; i < Nx; i++) {
+	U(i,j) = u;
+	V(i,j) = v;
+      }
+    }
+  } // Fill
+
+  void Ghosts(void) {
+    // Copy the boundary cells into the ghost layer (zero-flux boundaries)
+    for (int j = 1; j <= Ny; j++) {
+      float* r = a + W*j;
+      r[0] = r[2];
+      r[1] = r[3];
+      r[W-2] = r[W-4];
+      r[W-1] = r[W-3];
+    }
+    memcpy(a, a + W, W*sizeof(float));
+    memcpy(a + W*(Ny+1), a + W*Ny, W*sizeof(float));
+  } // Ghosts
+
+  template<int MODEL>
+  void Update(void) {
+    // Fused Laplacians and reaction, from a into b
+    const int w = W;
+    const float du = Du*dt, dv = Dv*dt, h = dt;
+    const float f = F, fk = F + k, c = kappa, r = 1.0f / tau;
+    for (int j = 1; j <= Ny; j++) {
+      const float* __restrict p = a + w*j + 2;
+      float* __restrict q = b + w*j + 2;
+      for (int i = 0; i < 2*Nx; i += 2) {
+	float u = p[i];
+	float v = p[i+1];
+	float lu = p[i-2] + p[i+2] + p[i-w] + p[i+w] - 4.0f*u;
+	float lv = p[i-1] + p[i+3] + p[i+1-w] + p[i+1+w] - 4.0f*v;
+	float ru, rv;
+	if (MODEL == GRAY_SCOTT) {
+	  float uvv = u*v*v;
+	  ru = f*(1.0f - u) - uvv;
+	  rv = uvv - fk*v;
+	} else {
+	  ru = u - u*u*u - v + c;
+	  rv = r*(u - v);
+	}
+	q[i]   = u + du*lu + h*ru;
+	q[i+1] = v + dv*lv + h*rv;
+      }
+    }
+  } // Update
+
+};
+
+#endif // REACTION_H
@@ -0,0 +1,116 @@
+// Measure the throughput of the reaction-diffusion step (Gray-Scott and
+// FitzHugh-Nagumo), from the 44x44 grid of initial_conditions.png up to
+// 2048x2048: a reference implementation (separate u and v arrays, one pass
+// per term, with branches at the boundaries) against the fused pass over
+// interleaved fields with a ghost layer. After the same number of steps,
+// the Gray-Scott fields of the two must agree to within a tolerance (they
+// round differently, and the fused step flushes denormals): the largest
+// difference is reported, and the benchmark fails when it is exceeded.
+//
+// usage: ./reaction_benchmark [max_size]
+
+// include project headers
+#include "reaction.h" // Reaction
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi, rand
+#include<cmath>     // abs
+#include<algorithm> // max
+#include<vector>    // vector
+#include<chrono>    // steady_clock
+
+// reference Gray-Scott step: separate fields, and one pass per term
+void reference(Reaction& r, std::vector<float>& u, std::vector<float>& v,
+	       std::vector<float>& du, std::vector<float>& dv) {
+  int Nx = r.Nx, Ny = r.Ny;
+  for (int j = 0; j < Ny; j++) {
+    for (int i = 0; i < Nx; i++) {
+      // 5-point Laplacians, with zero-flux boundaries
+      int k = Nx*j+i;
+      int w = (i > 0) ? k-1 : k, e = (i < Nx-1) ? k+1 : k;
+      int s = (j > 0) ? k-Nx : k, n = (j < Ny-1) ? k+Nx : k;
+      du[k] = r.Du * (u[w] + u[e] + u[s] + u[n] - 4.0*u[k]);
+      dv[k] = r.Dv * (v[w] + v[e] + v[s] + v[n] - 4.0*v[k]);
+    }
+  }
+  for (int k = 0; k < Nx*Ny; k++) {
+    float uvv = u[k]*v[k]*v[k];
+    du[k] += r.F*(1.0 - u[k]) - uvv;
+    dv[k] += uvv - (r.F + r.k)*v[k];
+  }
+  for (int k = 0; k < Nx*Ny; k++) {
+    u[k] += r.dt*du[k];
+    v[k] += r.dt*dv[k];
+  }
+}
+
+// seed a square of the Gray-Scott pattern, with noise
+void seed(Reaction& r) {
+  for (int j = 0; j < r.Ny; j++) {
+    for (int i = 0; i < r.Nx; i++) {
+      if ((std::abs(i - r.Nx/2) < 5) && (std::abs(j - r.Ny/2) < 5)) {
+	r.U(i,j) = 0.5;
+	r.V(i,j) = 0.25;
+      }
+      r.V(i,j) += 0.01*rand()/RAND_MAX;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  int max_size = (argc > 1) ? std::atoi(argv[1]) : 2048;
+  const float tolerance = 1.0e-3; // largest difference of u or v
+  std::cout << "# size    reference (steps/s)   Gray-Scott (steps/s)   (ns/cell)   FitzHugh-Nagumo (steps/s)   (ns/cell)   difference" << std::endl;
+  for (int n = 44; n <= max_size; n = (n < 256) ? 256 : 2*n) {
+    // about a second of work per measurement, at ~2 ns/cell
+    int steps = std::max(4, 500000000 / (n*n) / 2);
+
+    Reaction r(n, n, Reaction::GRAY_SCOTT);
+    seed(r);
+    std::vector<float> u(n*n), v(n*n), du(n*n), dv(n*n);
+    for (int j = 0; j < n; j++) {
+      for (int i = 0; i < n; i++) {
+	u[n*j+i] = r.U(i,j);
+	v[n*j+i] = r.V(i,j);
+      }
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+      reference(r, u, v, du, dv);
+    }
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    double t0 = std::chrono::duration<double>(stop - start).count() / steps;
+
+    r.Step(steps);
+    double t1 = 1.0 / r.Rate();
+    float difference = 0.0;
+    for (int j = 0; j < n; j++) {
+      for (int i = 0; i < n; i++) {
+	difference = std::max(difference, std::abs(u[n*j+i] - r.U(i,j)));
+	difference = std::max(difference, std::abs(v[n*j+i] - r.V(i,j)));
+      }
+    }
+    if (difference > tolerance) {
+      std::cerr << n << "x" << n << ": the fused Gray-Scott step differs from the reference by "
+		<< difference << " after " << steps << " steps" << std::endl;
+      return 1;
+    }
+
+    Reaction q(n, n, Reaction::FITZHUGH_NAGUMO);
+    for (int j = 0; j < n; j++) {
+      for (int i = 0; i < n; i++) {
+	q.U(i,j) = 2.0*rand()/RAND_MAX - 1.0;
+	q.V(i,j) = 2.0*rand()/RAND_MAX - 1.0;
+      }
+    }
+    q.Step(steps);
+    double t2 = 1.0 / q.Rate();
+
+    std::cout << n << "      " << 1.0/t0 << "              " << 1.0/t1
+	      << "               " << 1.0e9*t1/(n*n)
+	      << "      " << 1.0/t2 << "                     " << 1.0e9*t2/(n*n)
+	      << "      " << difference << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,79 @@
+// Find the crossover between the explicit 5-point stencil and the exact
+// (spectral) diffusion step on periodic grids, from the 44x44 grid of
+// initial_conditions.png up to 1024x1024.
+//
+// An explicit step is only stable up to dt = h^2/(4k), whereas a spectral
+// step of any length costs the same: the spectral step wins once the time
+// to advance between two displayed frames exceeds (cost of a spectral step
+// / cost of an explicit step) stable explicit steps.
+//
+// usage: ./spectral_benchmark [max_size]
+
+// include project headers
+#include "spectral.h" // SpectralDiffusion
+
+// include standard C/C++ libraries
+#include<iostream>  // cout
+#include<cstdlib>   // atoi, rand
+#include<vector>    // vector
+#include<chrono>    // steady_clock
+
+// explicit periodic step of u' = k Lu, with f = k dt / h^2 (at most 1/4)
+void stencil(std::vector<float>& u, std::vector<float>& v, int n, float f) {
+  for (int j = 0; j < n; j++) {
+    const float* c = u.data() + n*j;
+    const float* s = u.data() + n*((j+n-1)%n);
+    const float* t = u.data() + n*((j+1)%n);
+    float* r = v.data() + n*j;
+    r[0] = c[0] + f*(c[n-1] + c[1] + s[0] + t[0] - 4.0f*c[0]);
+    for (int i = 1; i < n-1; i++) {
+      r[i] = c[i] + f*(c[i-1] + c[i+1] + s[i] + t[i] - 4.0f*c[i]);
+    }
+    r[n-1] = c[n-1] + f*(c[n-2] + c[0] + s[n-1] + t[n-1] - 4.0f*c[n-1]);
+  }
+  u.swap(v);
+}
+
+int main(int argc, char** argv) {
+  int max_size = (argc > 1) ? std::atoi(argv[1]) : 1024;
+  const float k = 0.0003; // diffusivity (of the diffusion app)
+  std::cout << "# size   stencil (ms/step)   spectral (ms/step)   2 fields (ms/step)"
+            << "   crossover (stencil steps)   (dt, s)" << std::endl;
+  for (int n = 44; n <= max_size; n = (n < 64) ? 64 : 2*n) {
+    float h = 2.0 / n;
+    float dt = 0.25 * h*h / k; // largest stable explicit step
+    std::vector<float> u(n*n), v(n*n), w(n*n);
+    for (int i = 0; i < n*n; i++) {
+      u[i] = float(rand()) / RAND_MAX;
+      w[i] = u[i];
+    }
+
+    int steps = std::max(4, 50000000 / (n*n));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+      stencil(u, v, n, 0.25);
+    }
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    double t0 = std::chrono::duration<double,std::milli>(stop - start).count() / steps;
+
+    SpectralDiffusion spectral(n, n, h, h);
+    int transforms = std::max(2, steps / 20);
+    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < transforms; s++) {
+      spectral.Apply(u.data(), n, k * dt);
+    }
+    stop = std::chrono::steady_clock::now();
+    double t1 = std::chrono::duration<double,std::milli>(stop - start).count() / transforms;
+
+    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < transforms; s++) {
+      spectral.Apply(u.data(), w.data(), n, k * dt);
+    }
+    stop = std::chrono::steady_clock::now();
+    double t2 = std::chrono::duration<double,std::milli>(stop - start).count() / transforms;
+
+    std::cout << n << "      " << t0 << "            " << t1 << "             " << t2
+              << "             " << t1 / t0 << "                    " << dt * t1 / t0 << std::endl;
+  }
+  return 0;
+}
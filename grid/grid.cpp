@@ -5,124 +5,58 @@
 #include <GL/glut.h>
 #endif
 
-// include standard C/C++ libraries
-#include<iostream>  // exit
-#include<cmath>     // abs
-#include<unistd.h>  // usleep
-
-// forward declarations
-void motion(int x, int y);
-
-class Pixel {
-private :
-  float coordinate[2];
-  float dimension[2];
-  float color[3];
-  
-public :
-
-  void setCoordinate(float x, float y) {
-    coordinate[0] = x;
-    coordinate[1] = y;
-  }
-   
-  void setDimension(float w, float h) {
-    dimension[0] = w;
-    dimension[1] = h;
-  }
-
-  void setColor(float r, float g, float b) {
-    color[0] = r;
-    color[1] = g;
-    color[2] = b;
-  }
-
-  void render(int time) {
-    float c[3];
-    c[0] = color[0] * (0.75 + 0.25*std::sin(0.1*time));
-    c[1] = color[1] * (0.75 + 0.25*std::sin(0.1*time));
-    c[2] = color[2] * (0.75 + 0.25*std::sin(0.1*time));
-    glColor3f(c[0], c[1], c[2]); // color vertex 1
-    glVertex2f(coordinate[0]-0.5*dimension[0],coordinate[1]-0.5*dimension[1]);
-
-    glColor3f(c[0], c[1], c[2]); // color vertex 2
-    glVertex2f(coordinate[0]+0.5*dimension[0],coordinate[1]-0.5*dimension[1]);
-
-    glColor3f(c[0], c[1], c[2]); // color vertex 3
-    glVertex2f(coordinate[0]+0.5*dimension[0],coordinate[1]+0.5*dimension[1]);
-
-    glColor3f(c[0], c[1], c[2]); // color vertex 4
-    glVertex2f(coordinate[0]-0.5*dimension[0],coordinate[1]+0.5*dimension[1]);
-  }
-};
+// include project headers
+#include "app.h"    // App
+#include "canvas.h" // Canvas
 
-class Grid {
+// include standard C/C++ libraries
+#include<cmath>     // abs, sin, floor
+#include<algorithm> // min, max
+
+// The grid is drawn in retained mode: the cell colors live in a texture
+// (one texel per cell), the static geometry (a single textured quad) in a
+// display list, and the time-varying brightness is applied as a global
+// color, which modulates the texture. The CPU cost of a frame is thus
+// independent of the number of cells; painting a cell only uploads its
+// tile at the next frame.
+class Grid : public Simulation {
 private :
-  int Nx, Ny, Px, Py;
-  Pixel* pixels;
-  int time;
+  int Nx, Ny;
+  Canvas canvas; // Cell colors
+  GLuint list;   // Grid geometry (0 until the first frame)
+  float time;    // Animation time (in frames at 60 Hz)
 
 public :
 
-  void initialize(unsigned nx, unsigned ny, unsigned px, unsigned py) {
-    time = 0;
+  void initialize(unsigned nx, unsigned ny) {
+    time = 0.0;
+    list = 0;
     Nx = nx;
     Ny = ny;
-    Px = px;
-    Py = py;
     float w = 2.0 / Nx;
     float h = 2.0 / Ny;
-    pixels = new Pixel[Nx*Ny];
+    canvas.initialize(Nx, Ny);
     for (int j = 0; j < Ny; j++) {
       float y = h * (j + 0.5) - 1.0;
       for (int i = 0; i < Nx; i++) {
 	float x = w * (i + 0.5) - 1.0;
-	pixels[i+Nx*j].setCoordinate(x, y);
-	pixels[i+Nx*j].setDimension(w, h);
-	pixels[i+Nx*j].setColor(std::abs(x),std::abs(y),0.5);
+	canvas.paint(i, j, std::abs(x), std::abs(y), 0.5);
       }
     }
   } // initialize
 
-  void setWidth(int p) {
-    Px = p;
-  }
-
-  void setHeight(int p) {
-    Py = p;
-  }
-
-  void keyboard(unsigned char c, int x, int y) {
-    if (c == 27) { // ASCII code for the escape key
-      exit(0);
-    }
-  }
-
-  void mouse(int button, int state, int x, int y) {
-    if ((button == GLUT_LEFT_BUTTON) && (state == GLUT_DOWN)) {
-      float w = 2.0 / Nx;
-      float h = 2.0 / Ny;
-      int i = std::min(std::max(int(floor(((2.0 / Px) * x) / w)),0),Nx-1);
-      int j = std::min(std::max(int(floor((2.0 - (2.0 / Py) * y) / h)),0),Ny-1);
-      pixels[i+Nx*j].setColor(1.0,0.0,0.0);
-      glutMotionFunc(motion);
-      glutPostRedisplay(); // refresh the display
-    }
+  void step(float dt) {
+    // update the time variable
+    time += 60.0 * dt;
   }
 
-  void m_motion(int x, int y) {
-    float w = 2.0 / Nx;
-    float h = 2.0 / Ny;
-    int i = std::min(std::max(int(floor(((2.0 / Px) * x) / w)),0),Nx-1);
-    int j = std::min(std::max(int(floor((2.0 - (2.0 / Py) * y) / h)),0),Ny-1);
-    pixels[i+Nx*j].setColor(1.0,0.0,0.0);
-    glutPostRedisplay(); // refresh the display
+  void pointer(float x, float y, bool start) {
+    int i = std::min(std::max(int(floor(0.5 * (x + 1.0) * Nx)),0),Nx-1);
+    int j = std::min(std::max(int(floor(0.5 * (y + 1.0) * Ny)),0),Ny-1);
+    canvas.paint(i, j, 1.0, 0.0, 0.0);
   }
 
   void render() {
-    // clear the current bit buffers, restoring them to their preset values
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
     // Reset transformations
     glLoadIdentity();
     // Set the camera
@@ -137,119 +71,34 @@ public :
     // -4th arg: z-component of rotation axis
     glRotatef(1.0*time, 0.0, 0.0, 1.0);
 
-    // draw quadrilaterals
-    glBegin(GL_QUADS);
-    for (int j = 0; j < Ny; j++) {
-      for (int i = 0; i < Nx; i++) {
-	pixels[i+Nx*j].render(time);
-      }
-    }
-    glEnd(); // GL_QUADS
-
-    // for double buffering: display buffer that was just rendered
-    glutSwapBuffers();
+    // upload the tiles of the painted cells
+    canvas.upload();
 
-    // update the time variable
-    time+=1;
+    // record the geometry at the first frame: a textured quad spanning
+    // [-1,+1]x[-1,+1]
+    if (list == 0) {
+      list = glGenLists(1);
+      glNewList(list, GL_COMPILE);
+      canvas.draw();
+      glEndList();
+    }
 
+    // draw the grid, scaling all colors by the current brightness
+    float s = 0.75 + 0.25*std::sin(0.1*time);
+    glColor3f(s, s, s);
+    glCallList(list);
   } // render
-};
-
-// declare global grid instance
-Grid g;
-
-void keyboard(unsigned char c, int x, int y) {
-  g.keyboard(c, x, y);
-}
-
-void mouse(int button, int state, int x, int y) {
-  g.mouse(button, state, x, y);
-}
-
-void motion(int x, int y) {
-  g.m_motion(x, y);
-}
-
-void render() {
-  g.render();
-}
-
-void idle() {
-  glutMouseFunc(mouse);
-  glutPostRedisplay(); // refresh the display
-}
 
-void reshape(int w, int h) {
-  // Prevent a divide by zero, when window is too short
-  // (you cant make a window of zero width).
-  if (h == 0) {h = 1;}
-  float ratio = (1.0 * w) / h;
-
-  // change pixel dimension of the window
-  g.setWidth(glutGet(GLUT_WINDOW_WIDTH));
-  g.setHeight(glutGet(GLUT_WINDOW_HEIGHT));
-
-  // Use the Projection Matrix
-  glMatrixMode(GL_PROJECTION);
-
-  // Reset Matrix
-  glLoadIdentity();
-
-  // Set the viewport to be the entire window
-  // -1st & 2nd args: (x,y) coordinate of the bottom-left viewport corner
-  // -3rd & 4th args: (x,y) coordinate of the top-right viewport corner
-  glViewport(0, 0, w, h);
-
-  // Set the correct perspective.
-  // -1st arg: field of view angle in yz plane
-  // -2nd arg: (re-)define width-to-height ratio of the viewport
-  // -3rd arg: depth value of near clipping plane
-  // -4th arg: depth value of far clipping plane
-  gluPerspective(0,ratio,0,1000);
-
-  // Get Back to the Modelview
-  // -uses the scaling matrix in other glut functions, as needed
-  glMatrixMode(GL_MODELVIEW);
-}
+  bool rasterize(unsigned char* image, int w, int h) {
+    // the painted cells (without rotation or brightness)
+    canvas.rasterize(image, w, h);
+    return true;
+  } // rasterize
+};
 
 int main(int argc, char** argv) {
-  g.initialize(60, 60, 600, 600); // initialize the grid
-
-  // initialize glut
-  glutInit(&argc, argv);
-
-  // specify the initial position of the display window
-  //  -default value is (-1,-1), leading to automatic window placement
-  glutInitWindowPosition(100, 100);
-
-  // specify the initial size of the display window (in pixels)
-  glutInitWindowSize(600, 600);
-
-  // initialize the display modes:
-  // -define colors via RGBA values
-  // -use double buffering (for smoother animations)
-  // -use depth buffering (to correctly occlude objects with greater depth)
-  glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
-
-  // create the display window with the specified name
-  glutCreateWindow("Grid");
-
-  // define call-back functions:
-  // -main display function to run if there is a state change
-  glutDisplayFunc(render);
-  // -function to run in response to window resizing
-  glutReshapeFunc(reshape);
-  // -function to run in response to keyboard input
-  glutKeyboardFunc(keyboard);
-  // -function to run in response to mouse input
-  glutMouseFunc(mouse);
-  // -function to run if no active input is provided
-  glutIdleFunc(idle);
-  
-  // enter main display loop
-  glutMainLoop();
-
-  // the program should never reach this point; return 1 if it does
-  return 1;
+  Grid g;
+  g.initialize(60, 60); // initialize the grid
+  App app(&g, "Grid", "grid", 600, 600);
+  return app.run(argc, argv);
 }
-
@@ -1,52 +1,85 @@
-// #include <SFML/Audio.hpp>
-
-// int main()
-// {
-//     sf::SoundBuffer buffer;
-//     // load something into the sound buffer:
-//     if (!buffer.loadFromFile("sound.wav"))
-//         return -1;
-
-//     sf::Sound sound;
-//     sound.setBuffer(buffer);
-//     sound.play();
-
-//     return 0;
-// }
+// Sonify a stream of values with a synthesized sound stream.
+//
+// usage: ./audio      play a slow arpeggio
+//        ./audio -    read "value energy" pairs from the standard input
+//                     (e.g. the mean pressure head and the kinetic energy
+//                     of a simulation, piped in), mapping the value in
+//                     [0,1] to a pitch over two octaves above 220 Hz, and
+//                     the energy in [0,1] to the loudness
+//        ./audio render [voices] [seconds] [file]
+//                     render a cluster of voices (256, for 10 s by default)
+//                     offline, without an audio device, into a WAV file
+//                     (render.wav by default), and report the throughput
 
 #include <SFML/Audio.hpp>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
-int main() {
-	const unsigned SAMPLES = 44100;
-	const unsigned SAMPLE_RATE = 44100;
-	const unsigned AMPLITUDE = 30000;
-	
-	sf::Int16 raw[SAMPLES];
+#include "stream.h"
 
-	const double PI = 3.141592654;
-	const double increment = 440./44100;
-	const double step = 1.0594630944;
-	double f = pow(step,0);
-	double x = 0;
-	for (unsigned i = 0; i < SAMPLES; i++) {
-	  raw[i] = AMPLITUDE * sin(x*f*PI);
-		x += increment;
+// render a cluster of voices (all waveforms, spread over five octaves)
+// offline, into a WAV file
+int render(int voices, float seconds, const char* filename) {
+	const unsigned SAMPLE_RATE = 44100;
+	const unsigned BLOCK = 128;
+	Synth synth(SAMPLE_RATE);
+	voices = std::min(std::max(voices, 1), int(Synth::VOICES));
+	for (int v = 0; v < voices; v++) {
+		synth.push(v, 55.0 * pow(2.0, 5.0 * v / voices), 0.5 / sqrt(voices), v % Synth::WAVES);
+	}
+	std::vector<sf::Int16> raw(BLOCK * unsigned(seconds * SAMPLE_RATE / BLOCK));
+	for (unsigned s = 0; s < raw.size(); s += BLOCK) {
+		synth.render(raw.data() + s, BLOCK);
 	}
-	
-	sf::SoundBuffer Buffer;
-	if (!Buffer.loadFromSamples(raw, SAMPLES, 1, SAMPLE_RATE)) {
-		std::cerr << "Loading failed!" << std::endl;
+	if (!Synth::saveWav(filename, raw.data(), raw.size(), SAMPLE_RATE)) {
+		std::cerr << "Saving failed!" << std::endl;
 		return 1;
 	}
+	std::cout << voices << " voices, " << raw.size() << " samples: "
+		  << 1.0e6 * synth.seconds / synth.blocks << " us/block, "
+		  << 1.0e-6 * voices * synth.samples / synth.seconds << " Mvoice-samples/s, "
+		  << "load " << 100.0 * synth.load() << "%" << std::endl;
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if ((argc > 1) && (strcmp(argv[1], "render") == 0)) {
+		return render((argc > 2) ? atoi(argv[2]) : 256,
+			      (argc > 3) ? atof(argv[3]) : 10.0,
+			      (argc > 4) ? argv[4] : "render.wav");
+	}
+
+	SynthStream stream;
+	stream.play();
 
-	sf::Sound Sound;
-	Sound.setBuffer(Buffer);
-	Sound.setLoop(true);
-	Sound.play();
-	while (1) {
-		sf::sleep(sf::milliseconds(100));
+	bool piped = (argc > 1) && (strcmp(argv[1], "-") == 0);
+	const double step = 1.0594630944; // semitone
+	const int arpeggio[4] = {0, 4, 7, 12};
+	float value, energy, frequency = 440.0;
+	for (long n = 0; ; n++) {
+		if (piped) {
+			if (!(std::cin >> value >> energy)) break;
+			value = std::min(std::max(value, 0.0f), 1.0f);
+			frequency = 220.0 * pow(2.0, 2.0*value);
+			stream.synth.push(0, frequency, energy);
+		} else {
+			frequency = 440.0 * pow(step, arpeggio[(n/25)%4]);
+			stream.synth.push(0, frequency, 0.5);
+			sf::sleep(sf::milliseconds(10));
+		}
+		if (n % 100 == 99) {
+			Synth& s = stream.synth;
+			std::cerr << "synthesis: " << 1.0e6 * s.seconds / std::max(s.blocks.load(), 1L)
+				  << " us/block, load " << 100.0 * s.load() << "%" << std::endl;
+		}
 	}
+
+	// fade out
+	stream.synth.push(0, frequency, 0.0);
+	sf::sleep(sf::milliseconds(100));
+	stream.stop();
 	return 0;
 }
@@ -0,0 +1,51 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+// include SFML for audio output
+#include <SFML/Audio.hpp>
+
+// include standard C/C++ libraries
+#include <vector> // vector
+
+// include project headers
+#include "synth.h" // Synth
+
+// A sound stream that synthesizes its samples on demand, from a Synth.
+//
+// SFML keeps a few buffers queued, and asks for a new block whenever one
+// has been played: with blocks of 128 samples at 44.1 kHz (2.9 ms), the
+// latency of a control change stays below 10 ms.
+class SynthStream : public sf::SoundStream {
+public:
+
+  Synth synth; // Oscillator bank
+
+  SynthStream(unsigned rate = 44100, unsigned size = 128) : synth(rate), block(size) {
+    initialize(1, rate);
+    setProcessingInterval(sf::milliseconds(1)); // refill buffers promptly
+  } // SynthStream
+
+  ~SynthStream() {
+    // stop the audio thread before the synth and the block it reads are
+    // destroyed (SFML requires derived streams to stop themselves)
+    stop();
+  } // ~SynthStream
+
+private:
+
+  std::vector<sf::Int16> block; // Synthesized block
+
+  bool onGetData(Chunk& data) {
+    synth.render(block.data(), block.size());
+    data.samples = block.data();
+    data.sampleCount = block.size();
+    return true; // stream forever
+  } // onGetData
+
+  void onSeek(sf::Time offset) {
+    // a synthesized stream has no position
+  } // onSeek
+
+};
+
+#endif // STREAM_H
@@ -0,0 +1,279 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+// include standard C/C++ libraries
+#include <cmath>     // sin, atan
+#include <stdint.h>  // int16_t, uint32_t
+#include <cstdio>    // FILE, fopen
+#include <atomic>    // atomic
+#include <chrono>    // steady_clock
+#include <algorithm> // min, max
+
+// include the AVX2 intrinsics (compiled per function, and selected at run
+// time) on x86 targets
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h> // _mm256_i32gather_ps
+#define SYNTH_GATHER
+#endif
+
+// A bank of wavetable oscillators, synthesizing 16-bit mono samples in
+// blocks, on demand.
+//
+// Each voice plays one of a few waveforms from band-limited wavetables:
+// every waveform is tabulated at one level per octave of the playback
+// rate, with only the harmonics that stay below the Nyquist frequency at
+// that rate, so that no voice aliases. Phases are 32-bit fixed-point
+// accumulators (which wrap around exactly): the top bits index the table,
+// and the next 16 bits interpolate linearly between table samples. On CPUs
+// with AVX2, a voice is synthesized 8 samples at a time, with gathers of
+// the table samples.
+//
+// The voices are controlled through a lock-free single-producer/single-
+// consumer ring buffer of control messages (e.g. pitch and amplitude
+// driven by the state of a simulation), which the audio thread drains at
+// the start of every block. Frequency changes keep the phase continuous,
+// and amplitude changes are ramped over the block, so that controls never
+// cause clicks. The time spent synthesizing is measured per block.
+class Synth {
+public:
+
+  enum { VOICES = 256 };    // Number of voices
+  enum { BITS = 11 };       // Wavetable length, in bits
+  enum { TABLE = 1 << BITS };
+  enum { LEVELS = BITS };   // Band-limited levels (octaves) per waveform
+  enum { CAPACITY = 1024 }; // Control ring buffer capacity (a power of 2)
+
+  enum Wave { SINE, SAW, SQUARE, TRIANGLE, WAVES };
+
+  struct Control {
+    int voice;       // Voice index
+    float frequency; // Frequency (Hz)
+    float amplitude; // Amplitude, in [0,1]
+    int wave;        // Waveform
+  };
+
+  // Parameters
+  unsigned rate; // Sample rate (Hz)
+  float gain;    // Output scale (of a full-amplitude voice)
+  bool gather;   // Synthesize with AVX2 gathers (when the CPU supports them)
+
+  // Wavetables: one period, and a guard sample [WAVES][LEVELS][TABLE+1]
+  float* table;
+
+  // Voices
+  uint32_t phase[VOICES];     // Phase, in fractions of a period (2^-32)
+  uint32_t increment[VOICES]; // Phase increment per sample
+  float amplitude[VOICES];    // Current amplitude
+  float target[VOICES];       // Amplitude at the end of the block
+  const float* wave[VOICES];  // Wavetable
+
+  // Cost (written by the audio thread, and read by any other)
+  std::atomic<double> seconds; // Time spent synthesizing
+  std::atomic<long> blocks;    // Number of synthesized blocks
+  std::atomic<long> samples;   // Number of synthesized samples
+
+  Synth(unsigned r = 44100) {
+    rate = r;
+    gain = 8000.0;
+#ifdef SYNTH_GATHER
+    gather = __builtin_cpu_supports("avx2");
+#else
+    gather = false;
+#endif
+    tabulate();
+    for (int v = 0; v < VOICES; v++) {
+      phase[v] = 0;
+      increment[v] = 0;
+      amplitude[v] = 0.0;
+      target[v] = 0.0;
+      wave[v] = table;
+    }
+    head = 0;
+    tail = 0;
+    seconds = 0.0;
+    blocks = 0;
+    samples = 0;
+  } // Synth
+
+  ~Synth() {
+    delete[] table;
+  } // ~Synth
+
+  bool push(int voice, float frequency, float amplitude, int wave = SINE) {
+    // queue a control message (producer side); messages are dropped when
+    // the buffer is full
+    unsigned h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == CAPACITY) return false;
+    controls[h % CAPACITY] = {voice, frequency, amplitude, wave};
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  } // push
+
+  void render(int16_t* out, int n) {
+    // synthesize a block of n samples (consumer side)
+    for (; n > BLOCK; n -= BLOCK, out += BLOCK) {
+      render(out, BLOCK);
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    receive();
+
+    // clear the block, and mix the active voices into it
+    for (int s = 0; s < n; s++) {
+      mix[s] = 0.0;
+    }
+    for (int v = 0; v < VOICES; v++) {
+      if ((amplitude[v] == 0.0) && (target[v] == 0.0)) continue;
+      const float* __restrict w = wave[v];
+      float* __restrict m = mix;
+      const uint32_t p = phase[v];
+      const uint32_t dp = increment[v];
+      const float a = amplitude[v];
+      const float da = (target[v] - amplitude[v]) / n;
+      int s = 0;
+#ifdef SYNTH_GATHER
+      if (gather) s = mixGather(m, w, p, dp, a, da, n);
+#endif
+      for (; s < n; s++) {
+	// fixed-point phase: table index, and interpolation weight
+	uint32_t q = p + uint32_t(s) * dp;
+	uint32_t k = q >> (32 - BITS);
+	float f = ((q >> (16 - BITS)) & 0xffff) * (1.0f / 65536.0f);
+	m[s] += (a + s*da) * (w[k] + f * (w[k+1] - w[k]));
+      }
+      phase[v] = p + uint32_t(n) * dp;
+      amplitude[v] = target[v];
+    }
+
+    // convert to 16-bit samples, with saturation
+    for (int s = 0; s < n; s++) {
+      out[s] = std::min(std::max(gain * mix[s], -32768.0f), 32767.0f);
+    }
+
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(stop - start).count();
+    seconds.store(seconds.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+    blocks.fetch_add(1, std::memory_order_relaxed);
+    samples.fetch_add(n, std::memory_order_relaxed);
+  } // render
+
+#ifdef SYNTH_GATHER
+  __attribute__((target("avx2")))
+  static int mixGather(float* m, const float* w, uint32_t p, uint32_t dp, float a, float da,
+                       int n) {
+    // Mix 8 samples of a voice at a time, with 2 gathers (the table samples
+    // on either side of the phases), returning the number of samples mixed.
+    // The lanes round exactly as the scalar loop of render does (with no
+    // fused multiply-adds, which the target excludes), so that the output
+    // does not depend on whether the CPU has gathers
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i fraction = _mm256_set1_epi32(0xffff);
+    const __m256 scale = _mm256_set1_ps(1.0f / 65536.0f);
+    const __m256i p0 = _mm256_set1_epi32(p);
+    const __m256i step = _mm256_set1_epi32(dp);
+    const __m256 a0 = _mm256_set1_ps(a);
+    const __m256 ramp = _mm256_set1_ps(da);
+    int s = 0;
+    for (; s + 8 <= n; s += 8) {
+      // fixed-point phases (wrapping, as uint32_t does): table indices, and
+      // interpolation weights
+      __m256i i = _mm256_add_epi32(_mm256_set1_epi32(s), lanes);
+      __m256i q = _mm256_add_epi32(p0, _mm256_mullo_epi32(i, step));
+      __m256i k = _mm256_srli_epi32(q, 32 - BITS);
+      __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(q, 16 - BITS), fraction)),
+                               scale);
+      __m256 w0 = _mm256_i32gather_ps(w, k, 4);
+      __m256 w1 = _mm256_i32gather_ps(w, _mm256_add_epi32(k, one), 4);
+      __m256 x = _mm256_add_ps(w0, _mm256_mul_ps(f, _mm256_sub_ps(w1, w0)));
+      __m256 g = _mm256_add_ps(a0, _mm256_mul_ps(_mm256_cvtepi32_ps(i), ramp));
+      _mm256_storeu_ps(m + s, _mm256_add_ps(_mm256_loadu_ps(m + s), _mm256_mul_ps(g, x)));
+    }
+    return s;
+  } // mixGather
+#endif
+
+  static bool saveWav(const char* filename, const int16_t* x, int n, unsigned rate) {
+    // write 16-bit mono samples as a (PCM) WAV file
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) return false;
+    uint32_t bytes = 2*n;
+    uint32_t header[11] = {0x46464952, 36 + bytes, 0x45564157, // "RIFF", size, "WAVE"
+                           0x20746d66, 16, 0x00010001,         // "fmt ", 16, PCM, mono
+                           rate, 2*rate, 0x00100002,           // rates, alignment, bits
+                           0x61746164, bytes};                 // "data", size
+    fwrite(header, 4, 11, file);
+    fwrite(x, 2, n, file);
+    return (fclose(file) == 0);
+  } // saveWav
+
+  double load(void) {
+    // fraction of real time spent synthesizing
+    long n = samples.load(std::memory_order_relaxed);
+    return (n > 0) ? seconds.load(std::memory_order_relaxed) * rate / n : 0.0;
+  } // load
+
+private:
+
+  enum { BLOCK = 4096 }; // Largest block
+
+  Control controls[CAPACITY];
+  std::atomic<unsigned> head; // Next control to write
+  std::atomic<unsigned> tail; // Next control to read
+  float mix[BLOCK];           // Mixed block
+
+  void receive(void) {
+    // apply the queued control messages
+    unsigned t = tail.load(std::memory_order_relaxed);
+    unsigned h = head.load(std::memory_order_acquire);
+    for (unsigned k = t; k != h; k++) {
+      const Control& c = controls[k % CAPACITY];
+      if ((c.voice < 0) || (c.voice >= VOICES)) continue;
+      float f = std::min(std::max(c.frequency, 0.0f), 0.5f*rate) / rate;
+      increment[c.voice] = uint32_t(f * 4294967296.0);
+      target[c.voice] = std::min(std::max(c.amplitude, 0.0f), 1.0f);
+
+      // pick the level whose harmonics stay below the Nyquist frequency:
+      // level l serves increments of 2^l to 2^(l+1) table samples
+      int l = 0;
+      while ((l+1 < LEVELS) && ((increment[c.voice] >> (32 - BITS)) >> (l+1))) l++;
+      int w = std::min(std::max(c.wave, 0), WAVES-1);
+      wave[c.voice] = table + (size_t)(LEVELS*w + l)*(TABLE+1);
+    }
+    tail.store(h, std::memory_order_release);
+  } // receive
+
+  void tabulate(void) {
+    // tabulate the waveforms as Fourier series, level l holding the
+    // harmonics below TABLE/2^(l+2)
+    float pi = 4.0 * std::atan(1.0);
+    float sine[TABLE];
+    for (int k = 0; k < TABLE; k++) {
+      sine[k] = std::sin(2.0 * pi * k / TABLE);
+    }
+    table = new float[WAVES*LEVELS*(TABLE+1)];
+    for (int w = 0; w < WAVES; w++) {
+      for (int l = 0; l < LEVELS; l++) {
+	float* t = table + (size_t)(LEVELS*w + l)*(TABLE+1);
+	int harmonics = std::max(TABLE >> (l+2), 1);
+	for (int k = 0; k < TABLE; k++) {
+	  t[k] = 0.0;
+	}
+	for (int m = 1; m <= harmonics; m++) {
+	  // Fourier coefficient of the m-th harmonic (sine series)
+	  float b = (w == SINE)     ? ((m == 1) ? 1.0 : 0.0)
+	          : (w == SAW)      ? 2.0 / (pi*m) * ((m%2) ? 1.0 : -1.0)
+	          : (w == SQUARE)   ? ((m%2) ? 4.0 / (pi*m) : 0.0)
+	          : /* TRIANGLE */    ((m%2) ? 8.0 / (pi*pi*m*m) * ((m%4 == 1) ? 1.0 : -1.0) : 0.0);
+	  if (b == 0.0) continue;
+	  for (int k = 0; k < TABLE; k++) {
+	    t[k] += b * sine[(m*k) % TABLE];
+	  }
+	}
+	t[TABLE] = t[0]; // guard sample
+      }
+    }
+  } // tabulate
+
+};
+
+#endif // SYNTH_H